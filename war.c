@@ -1,229 +1,4924 @@
 /* Exemplo completo demonstrando alocação dinâmica de Territórios e Missões,
  * validação simples de ataques e a função liberarMemoria que libera tudo.
  *
- * Compile: gcc -Wall -Wextra -std=c11 -o war_example war_example.c
- * Execute: ./war_example
+ * Compile: gcc -Wall -Wextra -std=c11 -pthread -o war war.c
+ * Instrumentação: acrescente -DWAR_INSTRUMENTAR (resumo em stderr na saída)
+ * Benchmarks: gcc -O2 -std=c11 -pthread -o war war.c && ./war --bench
+ *             (acrescente -march=native para o kernel de batalhas usar AVX2/AVX-512)
+ * Execute: ./war
  */
 
+#define _POSIX_C_SOURCE 200809L // clock_gettime, sysconf
+
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* ------------------------------------------------------------------------
+ * Instrumentação (compilar com -DWAR_INSTRUMENTAR)
+ *
+ * Contadores de chamadas e de ciclos por fase do turno (validação, dados,
+ * conquista, missões, alocação). Cada thread soma no seu próprio bloco,
+ * sem atomics nem locks no caminho quente; os blocos ficam registrados numa
+ * lista global e o total é impresso em stderr na saída do programa. Sem a
+ * macro, INSTR_INICIO/INSTR_FIM não geram código algum.
+ * ------------------------------------------------------------------------ */
+
+typedef enum InstrPhase {
+    FASE_VALIDAR = 0,  // validarAtaque
+    FASE_DADOS,        // sorteios de resolverAtaque / resolverBatalha
+    FASE_CONQUISTA,    // atualização do tabuleiro após o combate
+    FASE_MISSOES,      // missaoCumprida
+    FASE_ALOCACAO,     // alocar / realocar
+    FASE_N
+} InstrPhase;
+
+#ifdef WAR_INSTRUMENTAR
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t instrCiclos(void) { return __rdtsc(); }
+#else
+static inline uint64_t instrCiclos(void) {
+    struct timespec ts; // sem contador de ciclos: nanossegundos
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/* Contadores de uma thread */
+typedef struct InstrCounters {
+    uint64_t calls[FASE_N];
+    uint64_t cycles[FASE_N];
+    struct InstrCounters *next; // lista global de blocos
+} InstrCounters;
+
+static _Thread_local InstrCounters *instrLocal;
+static InstrCounters *instrThreads;
+static pthread_mutex_t instrMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void imprimirInstrumentacao(void) {
+    static const char *nomes[FASE_N] = { "validar", "dados", "conquista", "missões", "alocação" };
+    uint64_t calls[FASE_N] = { 0 }, cycles[FASE_N] = { 0 };
+    int threads = 0;
+    pthread_mutex_lock(&instrMutex);
+    for (const InstrCounters *c = instrThreads; c; c = c->next, ++threads) {
+        for (int f = 0; f < FASE_N; ++f) {
+            calls[f] += c->calls[f];
+            cycles[f] += c->cycles[f];
+        }
+    }
+    pthread_mutex_unlock(&instrMutex);
+    fprintf(stderr, "Instrumentação (%d threads):\n", threads);
+    for (int f = 0; f < FASE_N; ++f) {
+        fprintf(stderr, "  %-10s %12llu chamadas %16llu ciclos %10.1f ciclos/chamada\n", nomes[f],
+                (unsigned long long)calls[f], (unsigned long long)cycles[f],
+                calls[f] ? (double)cycles[f] / (double)calls[f] : 0.0);
+    }
+}
+
+/* Bloco da thread atual, registrado no primeiro uso. Usa malloc direto:
+ * alocar também é instrumentada. */
+static InstrCounters *instrThread(void) {
+    if (instrLocal) return instrLocal;
+    InstrCounters *c = calloc(1, sizeof(InstrCounters));
+    if (!c) {
+        perror("calloc instrumentação");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_lock(&instrMutex);
+    if (!instrThreads) atexit(imprimirInstrumentacao);
+    c->next = instrThreads;
+    instrThreads = c;
+    pthread_mutex_unlock(&instrMutex);
+    return instrLocal = c;
+}
+
+static inline void instrRegistrar(InstrPhase fase, uint64_t cycles) {
+    InstrCounters *c = instrThread();
+    c->calls[fase]++;
+    c->cycles[fase] += cycles;
+}
+
+#define INSTR_INICIO(var) uint64_t var = instrCiclos()
+#define INSTR_FIM(var, fase) instrRegistrar((fase), instrCiclos() - (var))
+
+#else
+
+#define INSTR_INICIO(var) ((void)0)
+#define INSTR_FIM(var, fase) ((void)0)
+
+#endif /* WAR_INSTRUMENTAR */
+
+/* ------------------------------------------------------------------------
+ * Arena de memória por partida
+ *
+ * Toda a memória de uma partida (territórios, vizinhanças e missões)
+ * sai de poucos blocos grandes. Não existe free individual: liberarMemoria
+ * simplesmente reinicia a arena.
+ *
+ * Uma arena em modo pool (arenaUsarPool) não devolve blocos ao sistema: os
+ * blocos de uma partida encerrada vão para um pool global, separado por
+ * classe de tamanho (potências de 2), e a próxima partida monta seus
+ * territórios e missões sobre eles sem passar pelo malloc. O pool guarda
+ * no máximo ARENA_POOL_MAX_BYTES; o excesso é liberado normalmente.
+ * ------------------------------------------------------------------------ */
+
+#define ARENA_BLOCO_PADRAO (64 * 1024) // tamanho padrão de cada bloco
+#define ARENA_POOL_MAX_BYTES (256u << 20) // memória máxima parada no pool
+#define ARENA_POOL_CLASSES 48             // classes de tamanho (2^k bytes)
+
+/* Bloco de memória encadeado da arena */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next; // bloco anterior (lista encadeada)
+    size_t used;             // bytes já usados em data
+    size_t size;             // capacidade de data
+    max_align_t data[];      // área de alocação (alinhada)
+} ArenaBlock;
+
+/* Arena: alocador "bump" que só libera tudo de uma vez */
+typedef struct Arena {
+    ArenaBlock *head;  // bloco atual (onde acontecem as alocações)
+    size_t blockSize;  // tamanho padrão de novos blocos
+    int pooled;        // 1 = blocos vêm do pool global e voltam para ele
+} Arena;
+
+/* Pool global de blocos livres: uma pilha por classe de tamanho */
+static struct {
+    pthread_mutex_t lock;
+    ArenaBlock *free[ARENA_POOL_CLASSES]; // classe k: blocos com 2^k bytes
+    size_t bytes;                         // total parado no pool
+} arenaPool = { PTHREAD_MUTEX_INITIALIZER, { NULL }, 0 };
+
+/* Alocações feitas por alocar/realocar (todas as threads), lidas pelos
+ * benchmarks para que regressões de alocação apareçam */
+static atomic_long alocacoes;
+static atomic_long bytesAlocados;
+
+/* malloc que encerra o programa em caso de falha (padrão do projeto) */
+void *alocar(size_t size, const char *what) {
+    atomic_fetch_add_explicit(&alocacoes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytesAlocados, (long)size, memory_order_relaxed);
+    INSTR_INICIO(t0);
+    void *p = malloc(size);
+    INSTR_FIM(t0, FASE_ALOCACAO);
+    if (!p) {
+        perror(what);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/* CPUs online (pelo menos 1): número padrão de threads quando o chamador
+ * passa nThreads <= 0 */
+static int numeroDeNucleos(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+/* Inicializa uma arena vazia (blockSize = 0 usa o tamanho padrão) */
+void arenaInit(Arena *a, size_t blockSize) {
+    a->head = NULL;
+    a->blockSize = blockSize ? blockSize : ARENA_BLOCO_PADRAO;
+    a->pooled = 0;
+}
+
+/* Liga o modo pool: os próximos blocos vêm do pool global, e os blocos
+ * descartados por arenaReset/arenaDestroy voltam para ele */
+void arenaUsarPool(Arena *a) {
+    a->pooled = 1;
+}
+
+/* Classe de um bloco do pool: capacidades são potências de 2 */
+static inline int classeBloco(size_t cap) {
+    return 63 - __builtin_clzll((unsigned long long)cap);
+}
+
+/* Bloco de pelo menos 'size' bytes do pool (ou do malloc, se a classe está
+ * vazia). A capacidade é arredondada para a potência de 2 seguinte, então
+ * um bloco devolvido serve a qualquer pedido da mesma classe. */
+static ArenaBlock *retirarBlocoPool(size_t size) {
+    int k = size <= 1 ? 0 : 64 - __builtin_clzll((unsigned long long)(size - 1));
+    ArenaBlock *b = NULL;
+    if (k < ARENA_POOL_CLASSES) {
+        pthread_mutex_lock(&arenaPool.lock);
+        b = arenaPool.free[k];
+        if (b) {
+            arenaPool.free[k] = b->next;
+            arenaPool.bytes -= b->size;
+        }
+        pthread_mutex_unlock(&arenaPool.lock);
+    }
+    if (!b) {
+        size_t cap = (size_t)1 << k;
+        b = alocar(sizeof(ArenaBlock) + cap, "malloc arena");
+        b->size = cap;
+    }
+    b->used = 0;
+    return b;
+}
+
+/* Devolve um bloco ao pool, ou ao sistema se o pool estiver cheio */
+static void devolverBlocoPool(ArenaBlock *b) {
+    int k = classeBloco(b->size);
+    pthread_mutex_lock(&arenaPool.lock);
+    if (k < ARENA_POOL_CLASSES && arenaPool.bytes + b->size <= ARENA_POOL_MAX_BYTES) {
+        b->next = arenaPool.free[k];
+        arenaPool.free[k] = b;
+        arenaPool.bytes += b->size;
+        b = NULL;
+    }
+    pthread_mutex_unlock(&arenaPool.lock);
+    free(b);
+}
+
+/* Esvazia o pool global, devolvendo os blocos ao sistema */
+void esvaziarPoolArena(void) {
+    pthread_mutex_lock(&arenaPool.lock);
+    for (int k = 0; k < ARENA_POOL_CLASSES; ++k) {
+        while (arenaPool.free[k]) {
+            ArenaBlock *b = arenaPool.free[k];
+            arenaPool.free[k] = b->next;
+            free(b);
+        }
+    }
+    arenaPool.bytes = 0;
+    pthread_mutex_unlock(&arenaPool.lock);
+}
+
+/* Aloca size bytes alinhados dentro da arena */
+void *arenaAlloc(Arena *a, size_t size) {
+    const size_t align = sizeof(max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    ArenaBlock *b = a->head;
+    if (!b || b->size - b->used < size) {
+        // pedidos maiores que o bloco padrão ganham um bloco exclusivo
+        size_t cap = size > a->blockSize ? size : a->blockSize;
+        if (a->pooled) {
+            b = retirarBlocoPool(cap);
+        } else {
+            b = alocar(sizeof(ArenaBlock) + cap, "malloc arena");
+            b->used = 0;
+            b->size = cap;
+        }
+        b->next = a->head;
+        a->head = b;
+    }
+    void *p = (unsigned char *)b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+/* Copia uma string para dentro da arena */
+char *arenaStrdup(Arena *a, const char *s) {
+    size_t len = strlen(s) + 1;
+    char *p = arenaAlloc(a, len);
+    memcpy(p, s, len);
+    return p;
+}
+
+/* Descarta tudo o que foi alocado, mantendo o bloco mais recente para
+ * reaproveitar na próxima partida */
+void arenaReset(Arena *a) {
+    ArenaBlock *b = a->head;
+    if (!b) return;
+    ArenaBlock *old = b->next;
+    while (old) {
+        ArenaBlock *next = old->next;
+        if (a->pooled) devolverBlocoPool(old); else free(old);
+        old = next;
+    }
+    b->next = NULL;
+    b->used = 0;
+}
+
+/* Devolve todos os blocos ao sistema */
+void arenaDestroy(Arena *a) {
+    arenaReset(a);
+    if (a->pooled && a->head) devolverBlocoPool(a->head); else free(a->head);
+    a->head = NULL;
+}
+
+/* ------------------------------------------------------------------------
+ * Gerador de números aleatórios por partida
+ *
+ * Substitui rand(): o estado é explícito (um Rng por partida ou por thread),
+ * então não há estado global nem disputa entre threads, e a mesma semente
+ * reproduz a mesma sequência de dados. O gerador padrão é o xoshiro256**;
+ * compilar com -DWAR_RNG_PCG troca para PCG32 sem mudar a interface.
+ * ------------------------------------------------------------------------ */
+
+/* Estado do gerador */
+typedef struct Rng {
+#ifdef WAR_RNG_PCG
+    uint64_t state; // PCG32: estado e incremento (ímpar)
+    uint64_t inc;
+#else
+    uint64_t s[4];  // xoshiro256**
+#endif
+} Rng;
+
+/* splitmix64: espalha a semente pelos bits do estado */
+static inline uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+#ifdef WAR_RNG_PCG
+static inline uint32_t pcg32(Rng *r) {
+    uint64_t old = r->state;
+    r->state = old * 6364136223846793005ull + r->inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+#endif
+
+/* Inicializa o gerador a partir de uma semente de 64 bits */
+void rngSemear(Rng *r, uint64_t seed) {
+#ifdef WAR_RNG_PCG
+    r->state = splitmix64(&seed);
+    r->inc = splitmix64(&seed) | 1;
+#else
+    for (int i = 0; i < 4; ++i) r->s[i] = splitmix64(&seed);
+#endif
+}
+
+/* Próximos 64 bits aleatórios */
+static inline uint64_t rngProximo(Rng *r) {
+#ifdef WAR_RNG_PCG
+    uint64_t hi = pcg32(r);
+    return (hi << 32) | pcg32(r);
+#else
+    uint64_t *s = r->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+#endif
+}
+
+/* Mapeia 32 bits aleatórios para [0, n) sem viés (método de Lemire): só
+ * rejeita quando a parte baixa do produto cai na faixa que causaria viés */
+static inline uint32_t rngReduzir(Rng *r, uint32_t x, uint32_t n) {
+    uint64_t m = (uint64_t)x * n;
+    if ((uint32_t)m < n) {
+        uint32_t threshold = (uint32_t)-n % n;
+        while ((uint32_t)m < threshold) {
+            x = (uint32_t)(rngProximo(r) >> 32);
+            m = (uint64_t)x * n;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+/* Inteiro uniforme em [0, n) */
+static inline uint32_t rngIntervalo(Rng *r, uint32_t n) {
+    return rngReduzir(r, (uint32_t)(rngProximo(r) >> 32), n);
+}
+
+/* Rola um dado de 6 faces (1..6) */
+static inline int rolarDado(Rng *r) {
+    return (int)rngIntervalo(r, 6) + 1;
+}
+
+/* Rola n dados de uma vez: cada sorteio de 64 bits rende dois dados */
+void rolarDados(Rng *r, int *out, int n) {
+    int i = 0;
+    for (; i + 1 < n; i += 2) {
+        uint64_t x = rngProximo(r);
+        out[i] = (int)rngReduzir(r, (uint32_t)(x >> 32), 6) + 1;
+        out[i + 1] = (int)rngReduzir(r, (uint32_t)x, 6) + 1;
+    }
+    if (i < n) out[i] = rolarDado(r);
+}
+
+/* ------------------------------------------------------------------------
+ * Tabela global de strings internadas
+ *
+ * Nomes de territórios e textos de missões viram ids de 32 bits. Cada texto
+ * distinto é guardado uma única vez para o processo inteiro (as mesmas
+ * missões em milhares de partidas simuladas dividem a mesma cópia), e
+ * structs que guardam só o id podem ser copiadas com memcpy. Uma string
+ * internada nunca muda nem é liberada. textoString não trava: os blocos de
+ * ponteiros nunca se movem. internarString procura primeiro sem travar (o
+ * caso comum ao recarregar mapas e criar partidas) e só pega o mutex para
+ * inserir; a tabela hash antiga continua válida depois de crescer, então
+ * um leitor no meio da busca nunca lê memória liberada.
+ * ------------------------------------------------------------------------ */
+
+#define STRINGS_POR_BLOCO 4096
+#define STRINGS_MAX_BLOCOS 16384 // até 64M strings distintas
+
+/* Tabela hash aberta de ids. Ao crescer, a nova aponta para a antiga, que
+ * nunca é liberada (o total é no máximo o dobro da atual). */
+typedef struct StringSlots {
+    uint32_t mask;
+    struct StringSlots *prev;
+    _Atomic uint64_t slots[];  // hash << 32 | (id + 1) (0 = vazio)
+} StringSlots;
+
+typedef struct StringTable {
+    pthread_mutex_t lock;                              // só para inserir
+    Arena arena;                                       // textos
+    _Atomic(const char **) blocks[STRINGS_MAX_BLOCOS]; // id -> texto, em blocos fixos
+    uint32_t count;
+    _Atomic(StringSlots *) slots;                      // tabela atual (NULL = vazia)
+} StringTable;
+
+static StringTable tabelaStrings = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* FNV-1a de 32 bits */
+static uint32_t hashString(const char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s; ++s) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+/* Texto de uma string internada */
+static inline const char *textoString(uint32_t id) {
+    const char **block = atomic_load_explicit(&tabelaStrings.blocks[id / STRINGS_POR_BLOCO],
+                                              memory_order_acquire);
+    return block[id % STRINGS_POR_BLOCO];
+}
+
+/* Tabela hash vazia com mask + 1 posições */
+static StringSlots *criarSlotsStrings(uint32_t mask, StringSlots *prev) {
+    StringSlots *t = alocar(sizeof(StringSlots) + sizeof(uint64_t) * ((size_t)mask + 1), "malloc string table");
+    t->mask = mask;
+    t->prev = prev;
+    for (uint32_t i = 0; i <= mask; ++i) atomic_init(&t->slots[i], 0);
+    return t;
+}
+
+/* Procura 's' em 't' (o hash guardado no slot evita strcmp em colisões).
+ * Retorna o id ou UINT32_MAX; em 'slot' fica a posição vazia onde a busca
+ * parou. */
+static uint32_t buscarString(const StringSlots *t, const char *s, uint32_t h, uint32_t *slot) {
+    uint32_t k = h & t->mask;
+    for (uint64_t v; (v = atomic_load_explicit(&t->slots[k], memory_order_acquire)); k = (k + 1) & t->mask) {
+        uint32_t id = (uint32_t)v - 1;
+        if ((uint32_t)(v >> 32) == h && strcmp(textoString(id), s) == 0) return id;
+    }
+    *slot = k;
+    return UINT32_MAX;
+}
+
+/* Insere 's' (hash h) com o mutex da tabela já pego; retorna o id */
+static uint32_t inserirStringTravada(StringTable *st, const char *s, uint32_t h) {
+    StringSlots *t = atomic_load_explicit(&st->slots, memory_order_relaxed);
+    if (!t) {
+        arenaInit(&st->arena, 0);
+        t = criarSlotsStrings(1023, NULL);
+        atomic_store_explicit(&st->slots, t, memory_order_release);
+    }
+    // outra thread pode ter inserido entre a busca sem trava e o mutex
+    uint32_t slot;
+    uint32_t id = buscarString(t, s, h, &slot);
+    if (id != UINT32_MAX) return id;
+
+    id = st->count;
+    if (id / STRINGS_POR_BLOCO >= STRINGS_MAX_BLOCOS) {
+        fprintf(stderr, "internarString: tabela de strings cheia\n");
+        exit(EXIT_FAILURE);
+    }
+    const char **block = atomic_load_explicit(&st->blocks[id / STRINGS_POR_BLOCO], memory_order_relaxed);
+    if (!block) {
+        block = arenaAlloc(&st->arena, sizeof(const char *) * STRINGS_POR_BLOCO);
+        atomic_store_explicit(&st->blocks[id / STRINGS_POR_BLOCO], block, memory_order_release);
+    }
+    block[id % STRINGS_POR_BLOCO] = arenaStrdup(&st->arena, s);
+    // release: quem vê o slot vê também o texto
+    atomic_store_explicit(&t->slots[slot], (uint64_t)h << 32 | (id + 1), memory_order_release);
+    st->count++;
+
+    // fator de carga <= 1/2: nova tabela com o dobro, publicada já completa
+    if (st->count * 2 > t->mask + 1) {
+        StringSlots *grown = criarSlotsStrings(t->mask * 2 + 1, t);
+        for (uint32_t i = 0; i <= t->mask; ++i) {
+            uint64_t v = atomic_load_explicit(&t->slots[i], memory_order_relaxed);
+            if (!v) continue;
+            uint32_t k = (uint32_t)(v >> 32) & grown->mask;
+            while (atomic_load_explicit(&grown->slots[k], memory_order_relaxed)) k = (k + 1) & grown->mask;
+            atomic_store_explicit(&grown->slots[k], v, memory_order_relaxed);
+        }
+        atomic_store_explicit(&st->slots, grown, memory_order_release);
+    }
+    return id;
+}
+
+/* Retorna o id de 's', guardando uma cópia se ainda não existir */
+uint32_t internarString(const char *s) {
+    StringTable *st = &tabelaStrings;
+    uint32_t h = hashString(s), slot;
+    StringSlots *t = atomic_load_explicit(&st->slots, memory_order_acquire);
+    uint32_t id = t ? buscarString(t, s, h, &slot) : UINT32_MAX;
+    if (id != UINT32_MAX) return id;
+    pthread_mutex_lock(&st->lock);
+    id = inserirStringTravada(st, s, h);
+    pthread_mutex_unlock(&st->lock);
+    return id;
+}
+
+/* Interna n strings de uma vez: a i-ésima começa em names + offsets[i].
+ * As buscas não travam e adiantam a leitura dos slots das próximas; as
+ * que faltam são inseridas depois, todas sob um único lock. */
+void internarStringsEmLote(const char *names, const uint32_t *offsets, uint32_t n, uint32_t *ids) {
+    enum { ADIANTE = 8 };
+    StringTable *st = &tabelaStrings;
+    uint32_t *hashes = alocar(sizeof(uint32_t) * (n ? n : 1), "malloc lote de strings");
+    for (uint32_t i = 0; i < n; ++i) hashes[i] = hashString(names + offsets[i]);
+    StringSlots *t = atomic_load_explicit(&st->slots, memory_order_acquire);
+    uint32_t missing = 0, slot;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (t && i + ADIANTE < n) __builtin_prefetch(&t->slots[hashes[i + ADIANTE] & t->mask]);
+        ids[i] = t ? buscarString(t, names + offsets[i], hashes[i], &slot) : UINT32_MAX;
+        missing += ids[i] == UINT32_MAX;
+    }
+    if (missing) {
+        pthread_mutex_lock(&st->lock);
+        for (uint32_t i = 0; i < n; ++i)
+            if (ids[i] == UINT32_MAX) ids[i] = inserirStringTravada(st, names + offsets[i], hashes[i]);
+        pthread_mutex_unlock(&st->lock);
+    }
+    free(hashes);
+}
+
+/* Estrutura que representa um território no jogo.
+ *
+ * É apenas uma visão sobre o tabuleiro: dono e exércitos ficam nos arrays
+ * contíguos Board.owner[id] e Board.armies[id] (structure of arrays), para que
+ * varreduras do mapa inteiro não carreguem nomes e ponteiros na cache.
+ */
+typedef struct Territory {
+    uint32_t nameId;            // nome (id na tabela global de strings)
+    int id;                     // índice do território no tabuleiro
+} Territory;
+
+/* Tipos de missão (todos verificados em O(1) pelos contadores do tabuleiro) */
+typedef enum MissionType {
+    MISSAO_ELIMINAR = 1,       // eliminar o jogador targetOwner
+    MISSAO_CONQUISTAR,         // possuir 'count' territórios
+    MISSAO_CONQUISTAR_REGIAO   // possuir 'count' territórios da região 'region'
+} MissionType;
+
+/* Estrutura que representa uma missão estratégica */
+typedef struct Mission {
+    uint32_t descriptionId; // descrição (id na tabela global de strings)
+    int type;               // MissionType
+    int targetOwner;        // MISSAO_ELIMINAR: jogador a eliminar
+    int region;             // MISSAO_CONQUISTAR_REGIAO: região alvo
+    int count;              // territórios exigidos
+} Mission;
+
+/* Nome do território */
+static inline const char *nomeTerritorio(const Territory *t) {
+    return textoString(t->nameId);
+}
+
+/* Descrição da missão */
+static inline const char *descricaoMissao(const Mission *m) {
+    return textoString(m->descriptionId);
+}
+
+/* Resultado compacto de um combate (sem nenhuma saída de texto) */
+typedef struct CombatResult {
+    int from;           // id do território atacante
+    int to;             // id do território defensor
+    int attackerLoss;   // exércitos perdidos pelo atacante (inclui o que ocupa o conquistado)
+    int defenderLoss;   // exércitos perdidos pelo defensor
+    uint8_t attackRoll; // dado do atacante (1..6)
+    uint8_t defendRoll; // dado do defensor (1..6)
+    uint8_t conquered;  // 1 se o defensor foi conquistado
+} CombatResult;
+
+/* Ataque possível: ids do território atacante e do defensor */
+typedef struct Attack {
+    int from;
+    int to;
+} Attack;
+
+/* Estado anterior de um território, guardado no log de desfazer */
+typedef struct StateChange {
+    int id;
+    int owner;
+    int armies;
+} StateChange;
+
+/* Registro de um ataque feito com fazerAtaque/fazerBatalha: estado dos dois
+ * territórios antes do ataque (é tudo o que um ataque pode mudar) */
+typedef struct MoveRecord {
+    int from, to;
+    int fromOwner, fromArmies;
+    int toOwner, toArmies;
+} MoveRecord;
+
+struct Board;
+
+/* Receptor de eventos de combate: chamado depois de cada combate resolvido.
+ * Com sink NULL no tabuleiro, resolverAtaque não faz nenhuma E/S. */
+typedef void (*CombatSink)(void *ctx, const struct Board *b, const CombatResult *r);
+
+/* Tabuleiro de uma partida: territórios e grafo de vizinhança.
+ *
+ * Durante a montagem, adicionarVizinho apenas acumula arestas. finalizarMapa
+ * converte essa lista para o formato CSR (compressed sparse row): os vizinhos
+ * do território i são adjList[adjOffsets[i] .. adjOffsets[i + 1]), todos
+ * contíguos na memória.
+ */
+typedef struct Board {
+    Arena arena;              // memória da partida (territórios, missões, CSR)
+    Territory **territories;  // territórios indexados por id
+    int *owner;               // dono por id (0 = neutro / 1..n = jogadores)
+    int *armies;              // exércitos por id
+    int *region;              // região por id (-1 = sem região)
+    int nTerritories;
+    int capTerritories;
+    int nPlayers;             // maior id de jogador (calculado em finalizarMapa)
+    int nRegions;
+    int capRegions;
+    uint32_t *regionNames;    // nome de cada região (ids de string)
+    int *regionBonus;         // exércitos extras para quem controla a região inteira
+    int *regionStart;         // após finalizar: região r = ids [regionStart[r], regionStart[r + 1])
+    int *ownerCount;          // territórios por dono [0..nPlayers]
+    int *regionOwnerCount;    // territórios por (região, dono): [r * (nPlayers + 1) + dono]
+    int *playerBonus;         // soma dos bônus das regiões que cada dono controla
+    int *enemyCount;          // por id: arestas de saída para territórios de outro dono
+    uint64_t *frontierBits;   // fronteira por dono: linha p tem frontierWords palavras
+    int frontierWords;
+    int *frontierCount;       // territórios de fronteira por dono
+    int *ufNode;              // nó do union-find (blocos contíguos por dono) de cada id
+    int *ufParent;            // pai de cada nó
+    int *ufSize;              // territórios vivos sob cada raiz
+    int ufNodes;              // nós em uso
+    int ufCap;                // reserva de nós
+    int *ufQueue;             // rascunho da BFS de partição
+    int *ufLabel;             // grupo da BFS de partição de cada id visitado
+    int *ufGroup;             // rascunho dos grupos da partição (4 * maxDegree)
+    uint32_t *ufVisit;        // carimbos da BFS de partição
+    uint32_t ufStamp;
+    int *largestComponent;    // maior bloco contíguo por dono
+    uint8_t *largestStale;    // 1 = largestComponent precisa ser recalculado
+    int shared;               // 1 em clones: topologia emprestada de outro tabuleiro
+    int *edgeFrom;            // arestas pendentes (só até finalizarMapa)
+    int *edgeTo;
+    int nEdges;
+    int capEdges;
+    int *adjOffsets;          // CSR: nTerritories + 1 posições
+    int *adjList;             // CSR: nEdges ids de vizinhos
+    int *adjInOffsets;        // CSR reverso (quem tem 'id' como vizinho); aponta para
+    int *adjInList;           // adjOffsets/adjList quando o grafo é simétrico
+    int maxDegree;            // maior grau de saída + entrada
+    int adjIndexMode;         // ADJ_INDICE_* usado por saoVizinhos
+    uint64_t *adjBits;        // bitset: linha i tem adjWords palavras
+    int adjWords;
+    uint64_t *adjHash;        // conjunto hash de arestas (0 = vazio)
+    uint64_t adjHashMask;     // capacidade - 1 (potência de 2)
+    int finalized;            // 1 depois de finalizarMapa
+    CombatSink sink;          // eventos de combate (NULL = silencioso)
+    void *sinkCtx;
+    void *mapBase;            // arquivo de mapa mapeado (carregarMapaBinario) ou NULL
+    size_t mapSize;
+    StateChange *undoLog;     // alterações desde o snapshot mais antigo aberto
+    int undoLen;
+    int undoCap;
+    int undoDepth;            // snapshots abertos (0 = não registra)
+    MoveRecord *moves;        // pilha de ataques reversíveis (fazerAtaque)
+    int nMoves;
+    int capMoves;
+    uint64_t hash;            // hash Zobrist de (dono, exércitos) de todos os territórios
+    struct ReplayLog *replay; // gravador de eventos (NULL = não grava)
+} Board;
+
+/* Índice de adjacência usado por validarAtaque */
+enum {
+    ADJ_INDICE_AUTO = 0,  // escolhe pelo tamanho do mapa
+    ADJ_INDICE_BITSET,    // linhas de bits n x n (mapas pequenos/densos)
+    ADJ_INDICE_HASH       // conjunto hash de arestas (mapas grandes/esparsos)
+};
+
+#define ADJ_BITSET_MAX_BYTES (1u << 20) // limite de memória para o bitset
+#define ADJ_VARREDURA_MAX 8             // grau até o qual a linha CSR é varrida direto
+
+/* ------------------------------------------------------------------------
+ * Log de replay
+ *
+ * Arquivo binário só de anexação: um cabeçalho (semente, origem do mapa,
+ * tamanho e hash Zobrist inicial) seguido de um registro de tamanho fixo
+ * por evento: cada combate de resolverAtaque/resolverBatalha e cada
+ * reforço. O registro guarda o efeito do evento (exércitos resultantes e
+ * conquista), não só os dados, então reproduzirReplay reaplica a partida
+ * sem RNG e sem formatar texto. Cada lote gravado também regrava o total
+ * de eventos no cabeçalho, então um replay interrompido (queda do
+ * processo) ainda reproduz até o último lote. No fechamento, o hash final
+ * vai para o cabeçalho e a reprodução confere o estado final.
+ * ------------------------------------------------------------------------ */
+
+#define REPLAY_VERSAO 3
+#define REPLAY_LOTE 256 // registros acumulados por fwrite
+
+enum {
+    REPLAY_COMBATE = 1,
+    REPLAY_REFORCO
+};
+
+/* Um evento da partida (20 bytes) */
+typedef struct ReplayRecord {
+    int32_t from;          // atacante (-1 em reforços)
+    int32_t to;            // defensor / território reforçado
+    int32_t fromArmies;    // exércitos de 'from' depois do evento (0 em reforços)
+    int32_t toArmies;      // exércitos de 'to' depois do evento
+    uint8_t kind;          // REPLAY_*
+    uint8_t attackRoll;    // dados (0 em batalhas completas e reforços)
+    uint8_t defendRoll;
+    uint8_t conquered;     // 1 = 'to' passou para o dono de 'from'
+} ReplayRecord;
+
+_Static_assert(sizeof(ReplayRecord) == 20, "registro de replay deve ter 20 bytes");
+
+/* Origem do mapa da partida gravada */
+enum {
+    REPLAY_MAPA_EXEMPLO = 0,
+    REPLAY_MAPA_GERADO,    // parâmetros do gerador em ReplayMapInfo
+    REPLAY_MAPA_ARQUIVO    // mapa binário: a reprodução precisa de --mapa
+};
+
+/* Como refazer o mapa da partida (campos do gerador se REPLAY_MAPA_GERADO) */
+typedef struct ReplayMapInfo {
+    uint32_t source;       // REPLAY_MAPA_*
+    int32_t kind, nTerritories, nPlayers, nRegions, degree, degreeJitter, armies;
+    uint64_t seed;
+} ReplayMapInfo;
+
+#define REPLAY_FECHADO 1u  // flags: fecharReplay gravou o hash final
+
+/* Cabeçalho do arquivo de replay */
+typedef struct ReplayHeader {
+    char magic[8];         // "WARRPLY\0"
+    uint32_t version;
+    uint32_t nTerritories;
+    uint64_t seed;
+    uint64_t initialHash;  // hash Zobrist do tabuleiro no início
+    uint64_t finalHash;    // preenchido por fecharReplay
+    uint64_t events;       // eventos já gravados (atualizado a cada lote)
+    uint32_t flags;        // REPLAY_FECHADO
+    uint32_t reserved;
+    ReplayMapInfo map;
+} ReplayHeader;
+
+static const char REPLAY_MAGIC[8] = { 'W', 'A', 'R', 'R', 'P', 'L', 'Y', 0 };
+
+/* Gravador de replay de um tabuleiro (Board.replay) */
+typedef struct ReplayLog {
+    FILE *f;
+    ReplayHeader header;
+    int failed;                   // 1 depois de um erro de escrita (nada mais é gravado)
+    int n;                        // registros no buffer
+    ReplayRecord buf[REPLAY_LOTE];
+} ReplayLog;
+
+/* Cria o arquivo de replay para a partida que começa no estado atual de
+ * 'b', feito a partir do mapa descrito em 'map'. Retorna 1 em caso de
+ * sucesso. */
+int abrirReplay(ReplayLog *log, const char *path, const Board *b, uint64_t seed, const ReplayMapInfo *map) {
+    memset(log, 0, sizeof(*log));
+    log->f = fopen(path, "wb");
+    if (!log->f) {
+        perror(path);
+        return 0;
+    }
+    memcpy(log->header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    log->header.version = REPLAY_VERSAO;
+    log->header.nTerritories = (uint32_t)b->nTerritories;
+    log->header.seed = seed;
+    log->header.initialHash = b->hash;
+    log->header.map = *map;
+    if (fwrite(&log->header, sizeof(log->header), 1, log->f) != 1) {
+        perror(path);
+        fclose(log->f);
+        log->f = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+/* Grava o lote pendente e regrava o cabeçalho com o novo total de eventos,
+ * deixando tudo no sistema operacional (fflush). Depois de um erro, o
+ * replay fica marcado como falho e não grava mais nada. */
+static int descarregarReplay(ReplayLog *log) {
+    if (log->failed) return 0;
+    long end;
+    int ok = log->n == 0 || fwrite(log->buf, sizeof(ReplayRecord), (size_t)log->n, log->f) == (size_t)log->n;
+    if (ok && log->n) {
+        ok = (end = ftell(log->f)) >= 0 && fseek(log->f, 0, SEEK_SET) == 0 &&
+             fwrite(&log->header, sizeof(log->header), 1, log->f) == 1 &&
+             fseek(log->f, end, SEEK_SET) == 0 && fflush(log->f) == 0;
+    }
+    if (!ok) {
+        perror("replay");
+        log->failed = 1;
+    }
+    log->n = 0;
+    return ok;
+}
+
+/* Anexa um evento (buffer de REPLAY_LOTE registros por fwrite) */
+static inline void gravarEventoReplay(ReplayLog *log, const ReplayRecord *r) {
+    if (log->failed) return;
+    log->buf[log->n++] = *r;
+    log->header.events++;
+    if (log->n == REPLAY_LOTE) descarregarReplay(log);
+}
+
+/* Registra um combate já aplicado em 'b': os exércitos que ficaram nos dois
+ * territórios, não as perdas, para que a reprodução não dependa da regra de
+ * conquista (um defensor com 0 exércitos perde 1 em CombatResult) */
+static inline void gravarCombateReplay(ReplayLog *log, const Board *b, const CombatResult *c) {
+    ReplayRecord r = { c->from, c->to, b->armies[c->from], b->armies[c->to],
+                       REPLAY_COMBATE, c->attackRoll, c->defendRoll, c->conquered };
+    gravarEventoReplay(log, &r);
+}
+
+/* Registra o reforço já aplicado em 'id' */
+static inline void gravarReforcoReplay(ReplayLog *log, const Board *b, int id) {
+    ReplayRecord r = { -1, id, 0, b->armies[id], REPLAY_REFORCO, 0, 0, 0 };
+    gravarEventoReplay(log, &r);
+}
+
+/* Grava os eventos pendentes e o hash final de 'b' e fecha o arquivo */
+int fecharReplay(ReplayLog *log, const Board *b) {
+    int ok = descarregarReplay(log);
+    log->header.finalHash = b->hash;
+    log->header.flags |= REPLAY_FECHADO;
+    if (ok && !(fseek(log->f, 0, SEEK_SET) == 0 && fwrite(&log->header, sizeof(log->header), 1, log->f) == 1)) {
+        perror("replay");
+        ok = 0;
+    }
+    if (fclose(log->f) != 0) {
+        perror("fclose replay");
+        ok = 0;
+    }
+    log->f = NULL;
+    return ok;
+}
+
+/* realloc que encerra o programa em caso de falha */
+void *realocar(void *p, size_t size, const char *what) {
+    atomic_fetch_add_explicit(&alocacoes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytesAlocados, (long)size, memory_order_relaxed);
+    INSTR_INICIO(t0);
+    void *n = realloc(p, size);
+    INSTR_FIM(t0, FASE_ALOCACAO);
+    if (!n) {
+        perror(what);
+        exit(EXIT_FAILURE);
+    }
+    return n;
+}
+
+/* Prepara um tabuleiro vazio */
+void inicializarTabuleiro(Board *b) {
+    memset(b, 0, sizeof(*b));
+    arenaInit(&b->arena, 0);
+}
+
+/* Cria e retorna um território com nome e dono fornecidos */
+Territory *criarTerritorio(Board *b, const char *name, int owner, int armies) {
+    if (b->finalized) {
+        fprintf(stderr, "criarTerritorio: mapa já finalizado\n");
+        exit(EXIT_FAILURE);
+    }
+    if (b->nTerritories == b->capTerritories) {
+        b->capTerritories = b->capTerritories ? b->capTerritories * 2 : 16;
+        b->territories = realocar(b->territories, sizeof(Territory *) * b->capTerritories,
+                                  "realloc territories");
+        b->owner = realocar(b->owner, sizeof(int) * b->capTerritories, "realloc owner");
+        b->armies = realocar(b->armies, sizeof(int) * b->capTerritories, "realloc armies");
+        b->region = realocar(b->region, sizeof(int) * b->capTerritories, "realloc region");
+    }
+    Territory *t = arenaAlloc(&b->arena, sizeof(Territory));
+    t->nameId = internarString(name);
+    t->id = b->nTerritories;
+    b->owner[t->id] = owner;
+    b->armies[t->id] = armies;
+    b->region[t->id] = -1;
+    b->territories[b->nTerritories++] = t;
+    return t;
+}
+
+/* Cria uma região (continente) com o bônus de reforço de quem a controlar
+ * inteira e retorna seu id */
+int criarRegiao(Board *b, const char *name, int bonus) {
+    if (b->finalized) {
+        fprintf(stderr, "criarRegiao: mapa já finalizado\n");
+        exit(EXIT_FAILURE);
+    }
+    if (b->nRegions == b->capRegions) {
+        b->capRegions = b->capRegions ? b->capRegions * 2 : 8;
+        b->regionNames = realocar(b->regionNames, sizeof(uint32_t) * b->capRegions, "realloc regions");
+        b->regionBonus = realocar(b->regionBonus, sizeof(int) * b->capRegions, "realloc regions");
+    }
+    b->regionNames[b->nRegions] = internarString(name);
+    b->regionBonus[b->nRegions] = bonus;
+    return b->nRegions++;
+}
+
+/* Coloca o território na região (antes de finalizarMapa) */
+void definirRegiao(Board *b, Territory *t, int region) {
+    if (b->finalized || region < -1 || region >= b->nRegions) {
+        fprintf(stderr, "definirRegiao: região inválida ou mapa já finalizado\n");
+        exit(EXIT_FAILURE);
+    }
+    b->region[t->id] = region;
+}
+
+/* Registra 'vizinho' como vizinho de 't' (aresta dirigida). O grafo só pode
+ * ser consultado depois de finalizarMapa. */
+void adicionarVizinho(Board *b, Territory *t, Territory *vizinho) {
+    if (b->finalized) {
+        fprintf(stderr, "adicionarVizinho: mapa já finalizado\n");
+        exit(EXIT_FAILURE);
+    }
+    if (b->nEdges == b->capEdges) {
+        b->capEdges = b->capEdges ? b->capEdges * 2 : 16;
+        b->edgeFrom = realocar(b->edgeFrom, sizeof(int) * b->capEdges, "realloc edges");
+        b->edgeTo = realocar(b->edgeTo, sizeof(int) * b->capEdges, "realloc edges");
+    }
+    b->edgeFrom[b->nEdges] = t->id;
+    b->edgeTo[b->nEdges] = vizinho->id;
+    b->nEdges++;
+}
+
+/* Chaves Zobrist: em vez de tabelas (exércitos não têm limite), cada chave é
+ * um mix de 64 bits do par (território, valor), distinto para dono e
+ * exércitos. O hash do tabuleiro é o XOR das chaves de todos os territórios
+ * e é atualizado em O(1) a cada definirDono/definirExercitos. */
+static inline uint64_t zobristMix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    return x ^ (x >> 33);
+}
+
+static inline uint64_t zobristDono(int id, int owner) {
+    return zobristMix(((uint64_t)(uint32_t)id << 32 | (uint32_t)owner) ^ 0x5851F42D4C957F2Dull);
+}
+
+static inline uint64_t zobristExercitos(int id, int armies) {
+    return zobristMix(((uint64_t)(uint32_t)id << 32 | (uint32_t)armies) ^ 0x14057B7EF767814Full);
+}
+
+/* Recalcula o hash do zero (O(n)); usado ao finalizar/carregar o mapa */
+void recalcularHash(Board *b) {
+    uint64_t h = 0;
+    for (int i = 0; i < b->nTerritories; ++i)
+        h ^= zobristDono(i, b->owner[i]) ^ zobristExercitos(i, b->armies[i]);
+    b->hash = h;
+}
+
+/* Chave de aresta para o conjunto hash (+1 para que 0 signifique vazio) */
+static inline uint64_t chaveAresta(int from, int to) {
+    return (((uint64_t)(uint32_t)from << 32) | (uint32_t)to) + 1;
+}
+
+/* Posição inicial da chave no conjunto hash (hash multiplicativo) */
+static inline uint64_t slotAresta(uint64_t key, uint64_t mask) {
+    return ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+/* Constrói o índice de adjacência O(1) sobre o CSR já montado.
+ * Mapas cujo bitset n x n cabe em ADJ_BITSET_MAX_BYTES usam bits; os demais
+ * usam um conjunto hash com sondagem linear e fator de carga <= 1/2. */
+void construirIndiceAdjacencia(Board *b, int mode) {
+    int n = b->nTerritories;
+    int nEdges = b->adjOffsets[n];
+    if (mode == ADJ_INDICE_AUTO) {
+        size_t bytes = (size_t)n * (size_t)((n + 63) / 64) * sizeof(uint64_t);
+        mode = bytes <= ADJ_BITSET_MAX_BYTES ? ADJ_INDICE_BITSET : ADJ_INDICE_HASH;
+    }
+    b->adjBits = NULL;
+    b->adjHash = NULL;
+    if (mode == ADJ_INDICE_BITSET) {
+        int words = (n + 63) / 64;
+        size_t total = (size_t)n * (size_t)words;
+        b->adjBits = arenaAlloc(&b->arena, sizeof(uint64_t) * (total ? total : 1));
+        memset(b->adjBits, 0, sizeof(uint64_t) * total);
+        for (int i = 0; i < n; ++i) {
+            uint64_t *row = b->adjBits + (size_t)i * words;
+            for (int e = b->adjOffsets[i]; e < b->adjOffsets[i + 1]; ++e)
+                row[b->adjList[e] >> 6] |= 1ull << (b->adjList[e] & 63);
+        }
+        b->adjWords = words;
+    } else {
+        uint64_t cap = 16;
+        while (cap < (uint64_t)nEdges * 2) cap <<= 1;
+        b->adjHash = arenaAlloc(&b->arena, sizeof(uint64_t) * cap);
+        memset(b->adjHash, 0, sizeof(uint64_t) * cap);
+        b->adjHashMask = cap - 1;
+        for (int i = 0; i < n; ++i) {
+            for (int e = b->adjOffsets[i]; e < b->adjOffsets[i + 1]; ++e) {
+                uint64_t key = chaveAresta(i, b->adjList[e]);
+                uint64_t s = slotAresta(key, b->adjHashMask);
+                while (b->adjHash[s] && b->adjHash[s] != key) s = (s + 1) & b->adjHashMask;
+                b->adjHash[s] = key;
+            }
+        }
+    }
+    b->adjIndexMode = mode;
+}
+
+/* Aloca os contadores incrementais na arena do tabuleiro (nPlayers já definido) */
+static void alocarContadores(Board *b) {
+    size_t nOwner = (size_t)b->nPlayers + 1;
+    size_t nRegionOwner = (size_t)b->nRegions * nOwner;
+    b->ownerCount = arenaAlloc(&b->arena, sizeof(int) * nOwner);
+    b->playerBonus = arenaAlloc(&b->arena, sizeof(int) * nOwner);
+    b->regionOwnerCount = arenaAlloc(&b->arena, sizeof(int) * (nRegionOwner ? nRegionOwner : 1));
+    b->frontierWords = (b->nTerritories + 63) / 64;
+    b->enemyCount = arenaAlloc(&b->arena, sizeof(int) * (b->nTerritories ? b->nTerritories : 1));
+    b->frontierBits = arenaAlloc(&b->arena, sizeof(uint64_t) * nOwner * (b->frontierWords ? b->frontierWords : 1));
+    b->frontierCount = arenaAlloc(&b->arena, sizeof(int) * nOwner);
+    size_t n = b->nTerritories ? (size_t)b->nTerritories : 1;
+    b->ufCap = 2 * (int)n + b->maxDegree + 2;
+    b->ufNode = arenaAlloc(&b->arena, sizeof(int) * n);
+    b->ufParent = arenaAlloc(&b->arena, sizeof(int) * b->ufCap);
+    b->ufSize = arenaAlloc(&b->arena, sizeof(int) * b->ufCap);
+    b->ufNodes = 0;
+    b->ufQueue = arenaAlloc(&b->arena, sizeof(int) * n);
+    b->ufLabel = arenaAlloc(&b->arena, sizeof(int) * n);
+    b->ufGroup = arenaAlloc(&b->arena, sizeof(int) * 4 * (b->maxDegree ? b->maxDegree : 1));
+    b->ufVisit = arenaAlloc(&b->arena, sizeof(uint32_t) * n);
+    memset(b->ufVisit, 0, sizeof(uint32_t) * n);
+    b->ufStamp = 0;
+    b->largestComponent = arenaAlloc(&b->arena, sizeof(int) * nOwner);
+    b->largestStale = arenaAlloc(&b->arena, nOwner);
+}
+
+/* Recalcula do zero os territórios por dono e por (região, dono) */
+void recalcularContadores(Board *b) {
+    int stride = b->nPlayers + 1;
+    memset(b->ownerCount, 0, sizeof(int) * stride);
+    memset(b->regionOwnerCount, 0, sizeof(int) * (size_t)b->nRegions * stride);
+    for (int i = 0; i < b->nTerritories; ++i) {
+        b->ownerCount[b->owner[i]]++;
+        if (b->region[i] >= 0) b->regionOwnerCount[b->region[i] * stride + b->owner[i]]++;
+    }
+    memset(b->playerBonus, 0, sizeof(int) * stride);
+    for (int r = 0; r < b->nRegions; ++r) {
+        int size = b->regionStart[r + 1] - b->regionStart[r];
+        for (int p = 1; size > 0 && p <= b->nPlayers; ++p)
+            if (b->regionOwnerCount[r * stride + p] == size) b->playerBonus[p] += b->regionBonus[r];
+    }
+}
+
+/* Reordena os ids para que cada região ocupe uma faixa contígua (ordem
+ * estável por região; territórios sem região ficam no fim). Atualiza as
+ * visões Territory, os arrays por id e as arestas pendentes, e preenche
+ * regionStart. Chamada por finalizarMapa antes de montar o CSR. */
+static void ordenarPorRegiao(Board *b) {
+    int n = b->nTerritories, R = b->nRegions;
+    int *start = arenaAlloc(&b->arena, sizeof(int) * (R + 2));
+    memset(start, 0, sizeof(int) * (R + 2));
+    for (int i = 0; i < n; ++i) start[(b->region[i] < 0 ? R : b->region[i]) + 1]++;
+    for (int r = 0; r <= R; ++r) start[r + 1] += start[r];
+
+    int *newId = alocar(sizeof(int) * (n ? n : 1), "malloc newId");
+    int *cursor = alocar(sizeof(int) * (R + 1), "malloc cursor");
+    memcpy(cursor, start, sizeof(int) * (R + 1));
+    for (int i = 0; i < n; ++i) newId[i] = cursor[b->region[i] < 0 ? R : b->region[i]]++;
+    free(cursor);
+
+    Territory **territories = alocar(sizeof(Territory *) * b->capTerritories, "malloc territories");
+    int *owner = alocar(sizeof(int) * b->capTerritories, "malloc owner");
+    int *armies = alocar(sizeof(int) * b->capTerritories, "malloc armies");
+    int *region = alocar(sizeof(int) * b->capTerritories, "malloc region");
+    for (int i = 0; i < n; ++i) {
+        int j = newId[i];
+        territories[j] = b->territories[i];
+        territories[j]->id = j;
+        owner[j] = b->owner[i];
+        armies[j] = b->armies[i];
+        region[j] = b->region[i];
+    }
+    for (int e = 0; e < b->nEdges; ++e) {
+        b->edgeFrom[e] = newId[b->edgeFrom[e]];
+        b->edgeTo[e] = newId[b->edgeTo[e]];
+    }
+    free(newId);
+    free(b->territories);
+    free(b->owner);
+    free(b->armies);
+    free(b->region);
+    b->territories = territories;
+    b->owner = owner;
+    b->armies = armies;
+    b->region = region;
+    b->regionStart = start;
+}
+
+/* ------------------------------------------------------------------------
+ * Fronteiras
+ *
+ * Um território é fronteira quando tem algum vizinho de outro dono. Para
+ * cada id, enemyCount guarda quantos vizinhos são de outro dono, e cada
+ * dono tem um bitset com os seus territórios de fronteira. Quando 'id'
+ * muda de dono, só mudam enemyCount[id] e o de quem tem 'id' como vizinho
+ * (CSR reverso), então definirDono mantém tudo em O(grau). Consultas
+ * percorrem só as palavras do bitset do jogador.
+ * ------------------------------------------------------------------------ */
+
+#define FRONTEIRA_PARALELA_MIN 65536 // abaixo disso, threads custam mais do que economizam
+
+/* Monta o CSR reverso (arestas de entrada). Em grafos simétricos (o caso
+ * normal: adicionarVizinho nos dois sentidos) ele é o próprio CSR e nada é
+ * guardado. */
+static void construirAdjacenciaReversa(Board *b) {
+    int n = b->nTerritories, nEdges = b->adjOffsets[n];
+    int *offsets = alocar(sizeof(int) * (n + 1), "malloc reverse");
+    int *list = alocar(sizeof(int) * (nEdges ? nEdges : 1), "malloc reverse");
+    int *cursor = alocar(sizeof(int) * (n ? n : 1), "malloc cursor");
+    memset(offsets, 0, sizeof(int) * (n + 1));
+    for (int e = 0; e < nEdges; ++e) offsets[b->adjList[e] + 1]++;
+    for (int i = 0; i < n; ++i) offsets[i + 1] += offsets[i];
+    memcpy(cursor, offsets, sizeof(int) * n);
+    for (int i = 0; i < n; ++i)
+        for (int e = b->adjOffsets[i]; e < b->adjOffsets[i + 1]; ++e)
+            list[cursor[b->adjList[e]]++] = i;
+
+    // simétrico se, para cada i, entrada e saída são o mesmo multiconjunto
+    // ('cursor' vira contador por vizinho, zerado de volta a cada linha)
+    memset(cursor, 0, sizeof(int) * (n ? n : 1));
+    int simetrico = 1;
+    for (int i = 0; simetrico && i < n; ++i) {
+        if (offsets[i + 1] - offsets[i] != b->adjOffsets[i + 1] - b->adjOffsets[i]) { simetrico = 0; break; }
+        for (int e = b->adjOffsets[i]; e < b->adjOffsets[i + 1]; ++e) cursor[b->adjList[e]]++;
+        for (int e = offsets[i]; e < offsets[i + 1]; ++e) cursor[list[e]]--;
+        for (int e = b->adjOffsets[i]; e < b->adjOffsets[i + 1]; ++e) {
+            if (cursor[b->adjList[e]]) simetrico = 0;
+            cursor[b->adjList[e]] = 0;
+        }
+    }
+    free(cursor);
+    b->maxDegree = 0;
+    for (int i = 0; i < n; ++i) {
+        int deg = offsets[i + 1] - offsets[i] + b->adjOffsets[i + 1] - b->adjOffsets[i];
+        if (deg > b->maxDegree) b->maxDegree = deg;
+    }
+    if (simetrico) {
+        b->adjInOffsets = b->adjOffsets;
+        b->adjInList = b->adjList;
+    } else {
+        b->adjInOffsets = arenaAlloc(&b->arena, sizeof(int) * (n + 1));
+        b->adjInList = arenaAlloc(&b->arena, sizeof(int) * (nEdges ? nEdges : 1));
+        memcpy(b->adjInOffsets, offsets, sizeof(int) * (n + 1));
+        memcpy(b->adjInList, list, sizeof(int) * nEdges);
+    }
+    free(offsets);
+    free(list);
+}
+
+/* Linha do bitset de fronteira do dono */
+static inline uint64_t *linhaFronteira(const Board *b, int owner) {
+    return b->frontierBits + (size_t)owner * b->frontierWords;
+}
+
+/* Liga ou desliga 'id' na fronteira de 'owner' */
+static inline void marcarFronteira(Board *b, int id, int owner, int on) {
+    uint64_t *w = &linhaFronteira(b, owner)[id >> 6];
+    uint64_t bit = UINT64_C(1) << (id & 63);
+    if (((*w & bit) != 0) == on) return;
+    *w ^= bit;
+    b->frontierCount[owner] += on ? 1 : -1;
+}
+
+/* 1 se 'id' tem algum vizinho de outro dono, em O(1) */
+static inline int ehFronteira(const Board *b, int id) {
+    return b->enemyCount[id] > 0;
+}
+
+/* Atualiza as fronteiras depois que 'id' passou de 'old' para o dono atual */
+static inline void atualizarFronteira(Board *b, int id, int old) {
+    int owner = b->owner[id];
+    // quem aponta para 'id': o vizinho deixa (ou passa a) ser inimigo
+    for (int e = b->adjInOffsets[id]; e < b->adjInOffsets[id + 1]; ++e) {
+        int u = b->adjInList[e], ou = b->owner[u];
+        if (u == id) continue;
+        int delta = (ou != owner) - (ou != old);
+        if (!delta) continue;
+        b->enemyCount[u] += delta;
+        marcarFronteira(b, u, ou, b->enemyCount[u] > 0);
+    }
+    int enemies = 0;
+    for (int e = b->adjOffsets[id]; e < b->adjOffsets[id + 1]; ++e)
+        enemies += b->owner[b->adjList[e]] != owner;
+    b->enemyCount[id] = enemies;
+    marcarFronteira(b, id, old, 0);
+    marcarFronteira(b, id, owner, enemies > 0);
+}
+
+typedef struct FrontierTask {
+    Board *b;
+    int lo, hi;           // faixa de ids, alinhada a 64 (palavras disjuntas)
+    int *frontierCount;   // contadores locais da faixa
+    pthread_t thread;
+} FrontierTask;
+
+static void *threadFronteira(void *arg) {
+    FrontierTask *t = arg;
+    Board *b = t->b;
+    for (int i = t->lo; i < t->hi; ++i) {
+        int owner = b->owner[i], enemies = 0;
+        for (int e = b->adjOffsets[i]; e < b->adjOffsets[i + 1]; ++e)
+            enemies += b->owner[b->adjList[e]] != owner;
+        b->enemyCount[i] = enemies;
+        if (enemies) {
+            linhaFronteira(b, owner)[i >> 6] |= UINT64_C(1) << (i & 63);
+            t->frontierCount[owner]++;
+        }
+    }
+    return NULL;
+}
+
+/* Recalcula do zero enemyCount e as fronteiras de todos os donos (O(V + E)).
+ * Em mapas grandes, faixas de ids são divididas entre threads, cada uma com
+ * contadores locais somados no fim. nThreads <= 0 usa o número de CPUs. */
+void recalcularFronteiras(Board *b, int nThreads) {
+    int n = b->nTerritories, stride = b->nPlayers + 1;
+    memset(b->frontierBits, 0, sizeof(uint64_t) * (size_t)stride * b->frontierWords);
+    if (nThreads <= 0) nThreads = numeroDeNucleos();
+    if (n < FRONTEIRA_PARALELA_MIN) nThreads = 1;
+
+    FrontierTask *tasks = alocar(sizeof(FrontierTask) * nThreads, "malloc tasks");
+    int *counts = alocar(sizeof(int) * stride * nThreads, "malloc tasks");
+    memset(counts, 0, sizeof(int) * stride * nThreads);
+    int words = b->frontierWords;
+    for (int i = 0; i < nThreads; ++i) {
+        tasks[i].b = b;
+        tasks[i].lo = (int)((long)words * i / nThreads) * 64;
+        tasks[i].hi = (int)((long)words * (i + 1) / nThreads) * 64;
+        if (tasks[i].hi > n) tasks[i].hi = n;
+        tasks[i].frontierCount = counts + stride * i;
+    }
+    // a thread atual fica com a primeira faixa
+    for (int i = 1; i < nThreads; ++i) {
+        if (pthread_create(&tasks[i].thread, NULL, threadFronteira, &tasks[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    threadFronteira(&tasks[0]);
+    for (int i = 1; i < nThreads; ++i) pthread_join(tasks[i].thread, NULL);
+
+    memset(b->frontierCount, 0, sizeof(int) * stride);
+    for (int i = 0; i < nThreads; ++i)
+        for (int p = 0; p < stride; ++p) b->frontierCount[p] += tasks[i].frontierCount[p];
+    free(counts);
+    free(tasks);
+}
+
+/* Escreve em 'out' os territórios de fronteira do jogador, em ordem de id,
+ * e retorna quantos são. Custa O(nTerritories / 64 + fronteira). */
+int listarFronteiraJogador(const Board *b, int playerId, int *out) {
+    const uint64_t *row = linhaFronteira(b, playerId);
+    int count = 0;
+    for (int w = 0; w < b->frontierWords; ++w) {
+        for (uint64_t bits = row[w]; bits; bits &= bits - 1)
+            out[count++] = w * 64 + __builtin_ctzll(bits);
+    }
+    return count;
+}
+
+/* ------------------------------------------------------------------------
+ * Componentes por dono
+ *
+ * Blocos contíguos de territórios de um mesmo dono (vizinhança nos dois
+ * sentidos), mantidos por definirDono com union-find. Os nós da floresta
+ * não são os ids: cada território aponta para um nó (ufNode), e ufSize
+ * conta só os territórios vivos sob cada raiz. Assim um território pode
+ * sair de uma árvore sem desmontá-la: o nó antigo fica como caminho para os
+ * outros, e o território ganha um nó novo.
+ *
+ * Ganhar um território só une árvores (união por tamanho). Perder um pode
+ * partir o componente; a partição é localizada (ver separarComponente) e
+ * só os pedaços menores ganham nós novos. Quando os nós acabam, tudo é
+ * recalculado do zero (amortizado: a reserva é de 2n nós). O maior
+ * componente de cada dono é exato após uniões e marcado como desatualizado
+ * após uma perda, sendo recalculado só quando consultado.
+ * ------------------------------------------------------------------------ */
+
+/* Raiz de um nó (sem compressão: árvores por tamanho têm altura O(log n),
+ * e a consulta não escreve no tabuleiro) */
+static inline int raizNo(const Board *b, int node) {
+    while (b->ufParent[node] != node) node = b->ufParent[node];
+    return node;
+}
+
+/* Raiz do componente de 'id' */
+static inline int raizComponente(const Board *b, int id) {
+    return raizNo(b, b->ufNode[id]);
+}
+
+/* Raiz com compressão por metades (só durante atualizações) */
+static inline int raizNoCompactando(Board *b, int node) {
+    while (b->ufParent[node] != node) {
+        b->ufParent[node] = b->ufParent[b->ufParent[node]];
+        node = b->ufParent[node];
+    }
+    return node;
+}
+
+/* Reserva um nó raiz com 'size' territórios */
+static inline int novoNo(Board *b, int size) {
+    int node = b->ufNodes++;
+    b->ufParent[node] = node;
+    b->ufSize[node] = size;
+    return node;
+}
+
+/* Une os componentes dos territórios 'a' e 'c' (mesmo dono) */
+static inline void unirComponentes(Board *b, int a, int c) {
+    int ra = raizNoCompactando(b, b->ufNode[a]), rc = raizNoCompactando(b, b->ufNode[c]);
+    if (ra == rc) return;
+    if (b->ufSize[ra] < b->ufSize[rc]) { int t = ra; ra = rc; rc = t; }
+    b->ufParent[rc] = ra;
+    b->ufSize[ra] += b->ufSize[rc];
+    int owner = b->owner[a];
+    if (!b->largestStale[owner] && b->ufSize[ra] > b->largestComponent[owner])
+        b->largestComponent[owner] = b->ufSize[ra];
+}
+
+static inline void novoCarimboComponentes(Board *b) {
+    if (++b->ufStamp == 0) {
+        memset(b->ufVisit, 0, sizeof(uint32_t) * (b->nTerritories ? b->nTerritories : 1));
+        b->ufStamp = 1;
+    }
+}
+
+static inline int grupoRaiz(int *parent, int g) {
+    while (parent[g] != g) g = parent[g] = parent[parent[g]];
+    return g;
+}
+
+/* Retira 'id' do componente de 'old' (o dono já mudou). Os vizinhos que
+ * ficaram com 'old' são as origens de uma única BFS em que cada território
+ * leva o grupo (origem) que o alcançou; grupos que se encontram são unidos.
+ * Um grupo que esvazia a fila é um pedaço separado. A busca para quando
+ * resta um só grupo em aberto: esse fica com o nó raiz antigo e só os
+ * pedaços fechados (os menores, pois terminaram antes) recebem nós novos.
+ * Custa O(grau * tamanho dos pedaços menores), não O(componente). */
+static void separarComponente(Board *b, int id, int old) {
+    int root = raizComponente(b, id);
+    int dirs = b->adjInList == b->adjList ? 1 : 2; // grafo simétrico: um sentido basta
+    int *gParent = b->ufGroup, *gActive = gParent + b->maxDegree;
+    int *gOpen = gActive + b->maxDegree, *gNode = gOpen + b->maxDegree;
+    b->ufSize[root]--; // 'id' sai
+    novoCarimboComponentes(b);
+    b->ufVisit[id] = b->ufStamp;
+
+    int head = 0, tail = 0, groups = 0;
+    for (int dir = 0; dir < dirs; ++dir) {
+        const int *offsets = dir ? b->adjInOffsets : b->adjOffsets;
+        const int *list = dir ? b->adjInList : b->adjList;
+        for (int e = offsets[id]; e < offsets[id + 1]; ++e) {
+            int v = list[e];
+            if (b->owner[v] != old || b->ufVisit[v] == b->ufStamp) continue;
+            b->ufVisit[v] = b->ufStamp;
+            b->ufLabel[v] = groups;
+            gParent[groups] = groups;
+            gActive[groups] = 1;
+            gOpen[groups] = 1;
+            gNode[groups] = -1;
+            groups++;
+            b->ufQueue[tail++] = v;
+        }
+    }
+    if (groups <= 1) return; // no máximo um pedaço: nada a partir
+
+    int open = groups;
+    while (open > 1 && head < tail) {
+        int u = b->ufQueue[head++];
+        int g = grupoRaiz(gParent, b->ufLabel[u]);
+        for (int dir = 0; dir < dirs; ++dir) {
+            const int *offsets = dir ? b->adjInOffsets : b->adjOffsets;
+            const int *list = dir ? b->adjInList : b->adjList;
+            for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+                int v = list[e];
+                if (b->owner[v] != old) continue;
+                if (b->ufVisit[v] == b->ufStamp) {
+                    int h = grupoRaiz(gParent, b->ufLabel[v]);
+                    if (h != g) { // encontro: mesmo pedaço
+                        gParent[h] = g;
+                        gActive[g] += gActive[h];
+                        open--;
+                    }
+                    continue;
+                }
+                b->ufVisit[v] = b->ufStamp;
+                b->ufLabel[v] = g;
+                gActive[g]++;
+                b->ufQueue[tail++] = v;
+            }
+        }
+        if (--gActive[g] == 0) {
+            gOpen[g] = 0;
+            open--;
+        }
+    }
+
+    // pedaços fechados: todos os seus territórios estão em ufQueue[0, tail)
+    for (int k = 0; k < tail; ++k) {
+        int x = b->ufQueue[k], g = grupoRaiz(gParent, b->ufLabel[x]);
+        if (gOpen[g]) continue;
+        if (gNode[g] < 0) gNode[g] = novoNo(b, 0);
+        b->ufNode[x] = gNode[g];
+        b->ufSize[gNode[g]]++;
+        b->ufSize[root]--;
+    }
+}
+
+/* Recalcula do zero os componentes de todos os donos (O(V + E)) */
+void recalcularComponentes(Board *b) {
+    int stride = b->nPlayers + 1;
+    int dirs = b->adjInList == b->adjList ? 1 : 2;
+    novoCarimboComponentes(b);
+    b->ufNodes = 0;
+    memset(b->largestComponent, 0, sizeof(int) * stride);
+    memset(b->largestStale, 0, (size_t)stride);
+    for (int s = 0; s < b->nTerritories; ++s) {
+        if (b->ufVisit[s] == b->ufStamp) continue;
+        int owner = b->owner[s], node = novoNo(b, 0);
+        int head = 0, tail = 0;
+        b->ufVisit[s] = b->ufStamp;
+        b->ufQueue[tail++] = s;
+        while (head < tail) {
+            int u = b->ufQueue[head++];
+            b->ufNode[u] = node;
+            for (int dir = 0; dir < dirs; ++dir) {
+                const int *offsets = dir ? b->adjInOffsets : b->adjOffsets;
+                const int *list = dir ? b->adjInList : b->adjList;
+                for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+                    int v = list[e];
+                    if (b->owner[v] != owner || b->ufVisit[v] == b->ufStamp) continue;
+                    b->ufVisit[v] = b->ufStamp;
+                    b->ufQueue[tail++] = v;
+                }
+            }
+        }
+        b->ufSize[node] = tail;
+        if (tail > b->largestComponent[owner]) b->largestComponent[owner] = tail;
+    }
+}
+
+/* Atualiza os componentes depois que 'id' passou de 'old' para o dono atual */
+static void atualizarComponentes(Board *b, int id, int old) {
+    int owner = b->owner[id];
+    if (b->ufNodes + b->maxDegree + 1 > b->ufCap) {
+        recalcularComponentes(b); // reserva de nós esgotada
+        return;
+    }
+    if (b->ufSize[raizComponente(b, id)] == b->largestComponent[old])
+        b->largestStale[old] = 1; // o maior pode ter encolhido
+    separarComponente(b, id, old);
+
+    // 'id' entra como componente unitário e se une aos vizinhos do novo dono
+    b->ufNode[id] = novoNo(b, 1);
+    if (!b->largestStale[owner] && b->largestComponent[owner] < 1) b->largestComponent[owner] = 1;
+    int dirs = b->adjInList == b->adjList ? 1 : 2;
+    for (int dir = 0; dir < dirs; ++dir) {
+        const int *offsets = dir ? b->adjInOffsets : b->adjOffsets;
+        const int *list = dir ? b->adjInList : b->adjList;
+        for (int e = offsets[id]; e < offsets[id + 1]; ++e)
+            if (b->owner[list[e]] == owner) unirComponentes(b, id, list[e]);
+    }
+}
+
+/* 1 se 'a' e 'c' estão no mesmo bloco contíguo de um mesmo dono */
+static inline int mesmoComponente(const Board *b, int a, int c) {
+    return b->owner[a] == b->owner[c] && raizComponente(b, a) == raizComponente(b, c);
+}
+
+/* Tamanho do bloco contíguo que contém 'id' */
+static inline int tamanhoComponente(const Board *b, int id) {
+    return b->ufSize[raizComponente(b, id)];
+}
+
+/* Maior bloco contíguo de territórios do jogador. Exato em O(1), exceto
+ * logo depois de uma perda, quando custa uma varredura dos territórios. */
+int maiorComponente(Board *b, int playerId) {
+    if (b->largestStale[playerId]) {
+        int best = 0;
+        for (int i = 0; i < b->nTerritories; ++i)
+            if (b->owner[i] == playerId && tamanhoComponente(b, i) > best) best = tamanhoComponente(b, i);
+        b->largestComponent[playerId] = best;
+        b->largestStale[playerId] = 0;
+    }
+    return b->largestComponent[playerId];
+}
+
+/* 1 se o dono de 'from' chega a 'to' passando só por territórios dele: 'to'
+ * no mesmo bloco de 'from' ou vizinho de algum território desse bloco (um
+ * alvo de ataque). O(grau de entrada de 'to'). */
+int alcancavel(const Board *b, int from, int to) {
+    int owner = b->owner[from];
+    if (b->owner[to] == owner) return mesmoComponente(b, from, to);
+    int root = raizComponente(b, from);
+    for (int e = b->adjInOffsets[to]; e < b->adjInOffsets[to + 1]; ++e) {
+        int u = b->adjInList[e];
+        if (b->owner[u] == owner && raizComponente(b, u) == root) return 1;
+    }
+    return 0;
+}
+
+/* Constrói a adjacência CSR a partir das arestas acumuladas (counting sort:
+ * O(V + E), preservando a ordem de inserção dos vizinhos).
+ *
+ * Os ids são renumerados para agrupar as regiões (ver ordenarPorRegiao):
+ * guarde Territory*, não ids, obtidos antes de finalizar. */
+void finalizarMapa(Board *b) {
+    if (b->finalized) return;
+    ordenarPorRegiao(b);
+    int n = b->nTerritories;
+    int *offsets = arenaAlloc(&b->arena, sizeof(int) * (n + 1));
+    int *list = arenaAlloc(&b->arena, sizeof(int) * (b->nEdges ? b->nEdges : 1));
+    memset(offsets, 0, sizeof(int) * (n + 1));
+    for (int e = 0; e < b->nEdges; ++e) offsets[b->edgeFrom[e] + 1]++;
+    for (int i = 0; i < n; ++i) offsets[i + 1] += offsets[i];
+
+    // cursor de escrita por território (reaproveita a posição inicial)
+    int *cursor = alocar(sizeof(int) * (n ? n : 1), "malloc cursor");
+    memcpy(cursor, offsets, sizeof(int) * n);
+    for (int e = 0; e < b->nEdges; ++e) list[cursor[b->edgeFrom[e]]++] = b->edgeTo[e];
+    free(cursor);
+
+    b->adjOffsets = offsets;
+    b->adjList = list;
+    b->nPlayers = 0;
+    for (int i = 0; i < n; ++i)
+        if (b->owner[i] > b->nPlayers) b->nPlayers = b->owner[i];
+    recalcularHash(b);
+    construirAdjacenciaReversa(b);
+    alocarContadores(b);
+    recalcularContadores(b);
+    construirIndiceAdjacencia(b, ADJ_INDICE_AUTO);
+    recalcularFronteiras(b, 0);
+    recalcularComponentes(b);
+    free(b->edgeFrom);
+    free(b->edgeTo);
+    b->edgeFrom = b->edgeTo = NULL;
+    b->capEdges = 0;
+    b->finalized = 1;
+}
+
+/* Retorna os vizinhos do território 'id' (nVizinhos recebe a quantidade) */
+static inline const int *vizinhos(const Board *b, int id, int *nVizinhos) {
+    *nVizinhos = b->adjOffsets[id + 1] - b->adjOffsets[id];
+    return b->adjList + b->adjOffsets[id];
+}
+
+/* Dono do território (visão sobre Board.owner) */
+static inline int donoTerritorio(const Board *b, const Territory *t) {
+    return b->owner[t->id];
+}
+
+/* Exércitos do território (visão sobre Board.armies) */
+static inline int exercitosTerritorio(const Board *b, const Territory *t) {
+    return b->armies[t->id];
+}
+
+/* ------------------------------------------------------------------------
+ * Alterações de estado e snapshots
+ *
+ * Toda mudança de dono ou exércitos durante o jogo passa por definirDono /
+ * definirExercitos. Enquanto houver um snapshot aberto, o valor anterior do
+ * território vai para o log de desfazer, e restaurarSnapshot volta o
+ * tabuleiro em O(alterações), sem copiar o mapa. A topologia nunca muda e
+ * é compartilhada por clones (clonarTabuleiro), então uma busca pode
+ * ramificar, experimentar ataques e voltar atrás de forma barata.
+ * ------------------------------------------------------------------------ */
+
+/* Guarda o estado atual de 'id' no log, se houver snapshot aberto */
+static inline void registrarAlteracao(Board *b, int id) {
+    if (!b->undoDepth) return;
+    if (b->undoLen == b->undoCap) {
+        b->undoCap = b->undoCap ? b->undoCap * 2 : 64;
+        b->undoLog = realocar(b->undoLog, sizeof(StateChange) * b->undoCap, "realloc undo log");
+    }
+    StateChange *c = &b->undoLog[b->undoLen++];
+    c->id = id;
+    c->owner = b->owner[id];
+    c->armies = b->armies[id];
+}
+
+/* Troca o dono do território 'id' */
+static inline void definirDono(Board *b, int id, int owner) {
+    registrarAlteracao(b, id);
+    int old = b->owner[id];
+    b->hash ^= zobristDono(id, old) ^ zobristDono(id, owner);
+    b->ownerCount[old]--;
+    b->ownerCount[owner]++;
+    int r = b->region[id];
+    if (r >= 0 && old != owner) {
+        int *counts = b->regionOwnerCount + r * (b->nPlayers + 1);
+        int size = b->regionStart[r + 1] - b->regionStart[r];
+        // bônus de continente: só muda quando alguém completa ou perde a região
+        if (counts[old] == size && old) b->playerBonus[old] -= b->regionBonus[r];
+        counts[old]--;
+        counts[owner]++;
+        if (counts[owner] == size && owner) b->playerBonus[owner] += b->regionBonus[r];
+    }
+    b->owner[id] = owner;
+    if (old != owner) {
+        atualizarFronteira(b, id, old);
+        atualizarComponentes(b, id, old);
+    }
+}
+
+/* Troca o número de exércitos do território 'id' */
+static inline void definirExercitos(Board *b, int id, int armies) {
+    registrarAlteracao(b, id);
+    b->hash ^= zobristExercitos(id, b->armies[id]) ^ zobristExercitos(id, armies);
+    b->armies[id] = armies;
+}
+
+/* Abre um snapshot e retorna sua marca. Snapshots podem ser aninhados. */
+int abrirSnapshot(Board *b) {
+    b->undoDepth++;
+    return b->undoLen;
+}
+
+/* Desfaz tudo o que mudou desde abrirSnapshot (em ordem inversa) e fecha o
+ * snapshot */
+void restaurarSnapshot(Board *b, int mark) {
+    int depth = b->undoDepth;
+    b->undoDepth = 0; // restaurar não gera novas entradas
+    while (b->undoLen > mark) {
+        const StateChange *c = &b->undoLog[--b->undoLen];
+        definirDono(b, c->id, c->owner);
+        definirExercitos(b, c->id, c->armies);
+    }
+    b->undoDepth = depth - 1;
+}
+
+/* Fecha o snapshot mantendo as alterações. O log só é descartado quando o
+ * snapshot mais externo é fechado (os externos ainda podem desfazê-las). */
+void confirmarSnapshot(Board *b, int mark) {
+    (void)mark;
+    if (--b->undoDepth == 0) b->undoLen = 0;
+}
+
+/* Varreduras do tabuleiro inteiro: laços sem desvios sobre os arrays SoA,
+ * que o compilador vetoriza (SSE/AVX) com -O3; o GCC 12 com -O2 (o build de
+ * benchmarks) ainda os deixa escalares. */
+
+/* Soma dos exércitos de todos os territórios do jogador */
+long totalExercitosJogador(const Board *b, int playerId) {
+    const int *restrict owner = b->owner;
+    const int *restrict armies = b->armies;
+    long total = 0;
+    for (int i = 0; i < b->nTerritories; ++i)
+        total += armies[i] & -(owner[i] == playerId); // máscara em vez de desvio
+    return total;
+}
+
+/* Número de territórios do jogador */
+int contarTerritoriosJogador(const Board *b, int playerId) {
+    const int *restrict owner = b->owner;
+    int count = 0;
+    for (int i = 0; i < b->nTerritories; ++i)
+        count += owner[i] == playerId;
+    return count;
+}
+
+/* Escreve em 'out' os ids dos territórios do jogador e retorna quantos são
+ * ('out' precisa de espaço para nTerritories ids). Compactação sem desvios:
+ * não vetoriza, mas não sofre com erros de predição. */
+int listarTerritoriosJogador(const Board *b, int playerId, int *restrict out) {
+    const int *restrict owner = b->owner;
+    int count = 0;
+    for (int i = 0; i < b->nTerritories; ++i) {
+        out[count] = i;           // escrita incondicional: sem desvio
+        count += owner[i] == playerId;
+    }
+    return count;
+}
+
+/* Busca linear na linha CSR (usada para graus pequenos e como referência) */
+static inline int saoVizinhosLinear(const Board *b, int from, int to) {
+    int n;
+    const int *viz = vizinhos(b, from, &n);
+    for (int i = 0; i < n; ++i) {
+        if (viz[i] == to) return 1;
+    }
+    return 0;
+}
+
+/* Retorna 1 se 'to' é vizinho de 'from', em O(1) pelo índice do tabuleiro */
+static inline int saoVizinhos(const Board *b, int from, int to) {
+    if (b->adjIndexMode == ADJ_INDICE_BITSET)
+        return (int)((b->adjBits[(size_t)from * b->adjWords + (to >> 6)] >> (to & 63)) & 1);
+    // graus pequenos: a linha CSR cabe numa linha de cache, mais rápido que o hash
+    if (b->adjOffsets[from + 1] - b->adjOffsets[from] <= ADJ_VARREDURA_MAX)
+        return saoVizinhosLinear(b, from, to);
+    // no máximo uma volta pela tabela, mesmo que ela não tenha vazios
+    uint64_t key = chaveAresta(from, to);
+    uint64_t s = slotAresta(key, b->adjHashMask);
+    for (uint64_t k = 0; k <= b->adjHashMask && b->adjHash[s]; ++k, s = (s + 1) & b->adjHashMask) {
+        if (b->adjHash[s] == key) return 1;
+    }
+    return 0;
+}
+
+/* Cria e retorna uma missão */
+Mission *criarMissao(Board *b, const char *desc, MissionType type, int targetOwner, int region, int count) {
+    Mission *m = arenaAlloc(&b->arena, sizeof(Mission));
+    m->descriptionId = internarString(desc);
+    m->type = type;
+    m->targetOwner = targetOwner;
+    m->region = region;
+    m->count = count;
+    return m;
+}
+
+/* Jogador eliminado: não tem mais nenhum território */
+static inline int jogadorEliminado(const Board *b, int playerId) {
+    return b->ownerCount[playerId] == 0;
+}
+
+/* Número de territórios da região (faixa contígua de ids) */
+static inline int tamanhoRegiao(const Board *b, int region) {
+    return b->regionStart[region + 1] - b->regionStart[region];
+}
+
+/* Territórios do jogador na região, em O(1) */
+static inline int territoriosNaRegiao(const Board *b, int region, int playerId) {
+    return b->regionOwnerCount[region * (b->nPlayers + 1) + playerId];
+}
+
+/* 1 se o jogador possui a região inteira */
+static inline int controlaRegiao(const Board *b, int region, int playerId) {
+    return territoriosNaRegiao(b, region, playerId) == tamanhoRegiao(b, region);
+}
+
+/* Bônus de continente do jogador (mantido por definirDono), em O(1) */
+static inline int bonusContinentes(const Board *b, int playerId) {
+    return b->playerBonus[playerId];
+}
+
+/* Verifica se o jogador cumpriu a missão, em O(1): os contadores por dono e
+ * por (região, dono) são mantidos por definirDono a cada conquista. */
+static inline int verificarMissao(const Board *b, const Mission *m, int playerId) {
+    switch (m->type) {
+    case MISSAO_ELIMINAR:
+        return m->targetOwner != playerId && jogadorEliminado(b, m->targetOwner);
+    case MISSAO_CONQUISTAR:
+        return b->ownerCount[playerId] >= m->count;
+    case MISSAO_CONQUISTAR_REGIAO:
+        return territoriosNaRegiao(b, m->region, playerId) >= m->count;
+    default:
+        return 0;
+    }
+}
+
+/* Ponto de entrada público de verificarMissao (medido em FASE_MISSOES) */
+int missaoCumprida(const Board *b, const Mission *m, int playerId) {
+    INSTR_INICIO(t0);
+    int ok = verificarMissao(b, m, playerId);
+    INSTR_FIM(t0, FASE_MISSOES);
+    return ok;
+}
+
+/* Valida se um ataque é permitido:
+ * - jogador só pode atacar territórios que NÃO são dele
+ * - o território atacante deve ter pelo menos 2 exércitos (ex.: 1 fica para defesa)
+ * - 'to' precisa ser vizinho de 'from' (exige mapa finalizado)
+ */
+static inline int verificarAtaque(const Board *b, Territory *from, Territory *to, int playerId) {
+    if (!from || !to) return 0;
+    if (b->owner[from->id] != playerId) {
+        // só pode atacar se for dono do território atacante
+        return 0;
+    }
+    if (b->owner[to->id] == playerId) {
+        // não pode atacar um próprio território
+        return 0;
+    }
+    if (b->armies[from->id] < 2) {
+        // precisa de ao menos 2 exércitos para realizar ataque (um fica defendendo)
+        return 0;
+    }
+    // validar se 'to' é vizinho de 'from' (índice de adjacência O(1))
+    if (!saoVizinhos(b, from->id, to->id)) return 0;
+    return 1; // ataque válido
+}
+
+/* Ponto de entrada público de verificarAtaque (medido em FASE_VALIDAR) */
+int validarAtaque(const Board *b, Territory *from, Territory *to, int playerId) {
+    INSTR_INICIO(t0);
+    int ok = verificarAtaque(b, from, to, playerId);
+    INSTR_FIM(t0, FASE_VALIDAR);
+    return ok;
+}
+
+/* Gera todos os ataques válidos do jogador numa única passada: percorre só
+ * a fronteira dele (bitset mantido por definirDono), pulando territórios com
+ * menos de 2 exércitos, e de cada um a linha CSR de vizinhos. Escreve no
+ * máximo 'cap' ataques em 'out' (sem alocar nada) e retorna quantos
+ * existem; se o retorno passar de 'cap', a lista foi truncada. Um buffer de
+ * b->adjOffsets[b->nTerritories] ataques (uma posição por aresta) nunca
+ * trunca.
+ */
+int gerarAtaques(const Board *b, int playerId, Attack *out, int cap) {
+    const int *restrict owner = b->owner;
+    const int *restrict armies = b->armies;
+    const uint64_t *row = linhaFronteira(b, playerId);
+    int count = 0;
+    for (int w = 0; w < b->frontierWords; ++w) {
+        for (uint64_t bits = row[w]; bits; bits &= bits - 1) {
+            int i = w * 64 + __builtin_ctzll(bits);
+            if (armies[i] < 2) continue;
+            for (int e = b->adjOffsets[i]; e < b->adjOffsets[i + 1]; ++e) {
+                int to = b->adjList[e];
+                if (owner[to] == playerId) continue;
+                if (count < cap) {
+                    out[count].from = i;
+                    out[count].to = to;
+                }
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+/* Resolve um combate de um dado contra um dado (aleatório).
+ *
+ * Não imprime nada: o resultado vai para 'out' (se não for NULL) e para o
+ * sink do tabuleiro, se houver. Retorna 1 se o território foi conquistado.
+ */
+int resolverAtaque(Board *b, Rng *rng, Territory *from, Territory *to, CombatResult *out) {
+    int dice[2];
+    INSTR_INICIO(t0);
+    rolarDados(rng, dice, 2);
+    INSTR_FIM(t0, FASE_DADOS);
+    CombatResult r = { from->id, to->id, 0, 0, (uint8_t)dice[0], (uint8_t)dice[1], 0 };
+
+    INSTR_INICIO(t1);
+    if (r.attackRoll > r.defendRoll) {
+        // atacante vence: reduz defender, possivelmente conquista
+        r.defenderLoss = 1;
+        if (b->armies[to->id] - 1 <= 0) {
+            definirDono(b, to->id, b->owner[from->id]);
+            // mover pelo menos 1 exército do atacante para o território conquistado
+            definirExercitos(b, from->id, b->armies[from->id] - 1);
+            definirExercitos(b, to->id, 1);
+            r.attackerLoss = 1;
+            r.conquered = 1;
+        } else {
+            definirExercitos(b, to->id, b->armies[to->id] - 1);
+        }
+    } else {
+        // defensor vence
+        definirExercitos(b, from->id, b->armies[from->id] - 1);
+        r.attackerLoss = 1;
+    }
+    INSTR_FIM(t1, FASE_CONQUISTA);
+
+    if (out) *out = r;
+    if (b->replay) gravarCombateReplay(b->replay, b, &r);
+    if (b->sink) b->sink(b->sinkCtx, b, &r);
+    return r.conquered;
+}
+
+/* ------------------------------------------------------------------------
+ * Ataques em lote
+ *
+ * Uma IA emite dezenas de ordens por turno. resolverAtaquesEmLote recebe
+ * todas de uma vez: uma passada sem desvios sobre owner/armies (SoA)
+ * calcula a máscara de validade de todas as ordens, e só as que passam
+ * consultam o índice de adjacência. Depois as válidas são resolvidas em
+ * ordem; como uma ordem anterior pode ter mudado dono ou exércitos, dono e
+ * exércitos são conferidos de novo antes de cada combate (a adjacência não
+ * muda, então vale o resultado da primeira passada).
+ * ------------------------------------------------------------------------ */
+
+/* Situação de uma ordem do lote */
+enum {
+    LOTE_INVALIDO = 0,  // reprovada antes de resolver qualquer ordem
+    LOTE_RESOLVIDO,     // combate resolvido ('combat' preenchido)
+    LOTE_OBSOLETO       // válida no início, mas uma ordem anterior a invalidou
+};
+
+/* Resultado de uma ordem do lote */
+typedef struct AttackOutcome {
+    CombatResult combat;  // from/to sempre preenchidos; perdas e dados só se resolvido
+    uint8_t status;       // LOTE_*
+} AttackOutcome;
+
+/* Valida as n ordens do jogador de uma vez: ok[i] = 1 se orders[i] é um
+ * ataque válido (mesmas regras de validarAtaque; ids fora do mapa são
+ * inválidos). Retorna quantas são válidas. A primeira passada (dono,
+ * exércitos e limites) não tem desvios e vetoriza com -O3; 'ok' não pode
+ * se sobrepor a 'orders'. A adjacência vem numa segunda passada, só sobre
+ * as ordens que sobraram. */
+int validarAtaquesEmLote(const Board *b, int playerId, const Attack *restrict orders, int n, uint8_t *restrict ok) {
+    INSTR_INICIO(t0);
+    const int *restrict owner = b->owner;
+    const int *restrict armies = b->armies;
+    const unsigned nT = (unsigned)b->nTerritories;
+    // passada sem desvios: ids fora do mapa leem a posição 0 e são mascarados
+    for (int i = 0; i < n; ++i) {
+        unsigned from = (unsigned)orders[i].from, to = (unsigned)orders[i].to;
+        int inRange = (from < nT) & (to < nT);
+        from &= (unsigned)-inRange;
+        to &= (unsigned)-inRange;
+        ok[i] = (uint8_t)(inRange & (owner[from] == playerId) & (owner[to] != playerId) & (armies[from] >= 2));
+    }
+    int valid = 0;
+    for (int i = 0; i < n; ++i) {
+        if (ok[i] && !saoVizinhos(b, orders[i].from, orders[i].to)) ok[i] = 0;
+        valid += ok[i];
+    }
+    INSTR_FIM(t0, FASE_VALIDAR);
+    return valid;
+}
+
+/* Valida e resolve em ordem as n ordens de ataque do jogador (um dado
+ * contra um dado, como resolverAtaque; sink e replay recebem cada combate).
+ * out[i] recebe o resultado de orders[i]. Retorna quantos combates foram
+ * resolvidos. */
+int resolverAtaquesEmLote(Board *b, Rng *rng, int playerId, const Attack *orders, int n, AttackOutcome *out) {
+    uint8_t stackOk[256];
+    uint8_t *ok = n <= (int)sizeof(stackOk) ? stackOk : alocar((size_t)n, "malloc lote");
+    validarAtaquesEmLote(b, playerId, orders, n, ok);
+    int resolved = 0;
+    for (int i = 0; i < n; ++i) {
+        int from = orders[i].from, to = orders[i].to;
+        AttackOutcome *o = &out[i];
+        memset(o, 0, sizeof(*o));
+        o->combat.from = from;
+        o->combat.to = to;
+        if (!ok[i]) {
+            o->status = LOTE_INVALIDO;
+        } else if (b->owner[from] != playerId || b->owner[to] == playerId || b->armies[from] < 2) {
+            o->status = LOTE_OBSOLETO;
+        } else {
+            resolverAtaque(b, rng, b->territories[from], b->territories[to], &o->combat);
+            o->status = LOTE_RESOLVIDO;
+            resolved++;
+        }
+    }
+    if (ok != stackOk) free(ok);
+    return resolved;
+}
+
+/* ------------------------------------------------------------------------
+ * Batalhas completas por tabela de probabilidades
+ *
+ * Uma batalha repete o combate de um dado contra um dado até o defensor
+ * ser conquistado ou o atacante ficar com 1 exército (recuo). Cada rodada é
+ * um passeio aleatório: o defensor perde 1 com p = 15/36 (dado do atacante
+ * estritamente maior) e o atacante perde 1 com q = 21/36. Para A, D até
+ * BATALHA_TABELA_MAX, a distribuição do resultado final é pré-calculada,
+ * então uma batalha inteira custa um sorteio e uma busca binária.
+ * ------------------------------------------------------------------------ */
+
+#define BATALHA_TABELA_MAX 64   // maior número de exércitos tabelado (cada lado)
+#define BATALHA_P_ATACANTE 15   // em 36: chance do atacante vencer uma rodada
+
+/* CDFs dos resultados de cada (A, D). Para A atacantes e D defensores há
+ * A - 1 + D resultados: índice i < A - 1 é conquista com A - i exércitos no
+ * atacante; os demais são recuo com o defensor restando D - (i - (A - 1)).
+ * Resultados mais prováveis para o atacante vêm primeiro. */
+static double *tabelaBatalha;
+static int tabelaBatalhaOffset[BATALHA_TABELA_MAX + 1][BATALHA_TABELA_MAX + 1];
+static pthread_once_t tabelaBatalhaOnce = PTHREAD_ONCE_INIT;
+
+/* Calcula a distribuição final de cada (A, D) por programação dinâmica
+ * sobre as probabilidades de cada estado intermediário. */
+static void montarTabelaBatalha(void) {
+    const int T = BATALHA_TABELA_MAX;
+    const double p = BATALHA_P_ATACANTE / 36.0, q = 1.0 - p;
+    size_t total = 0;
+    for (int A = 2; A <= T; ++A)
+        for (int D = 1; D <= T; ++D) {
+            tabelaBatalhaOffset[A][D] = (int)total;
+            total += (size_t)(A - 1 + D);
+        }
+    double *table = alocar(sizeof(double) * total, "malloc tabela batalha");
+    double *grid = alocar(sizeof(double) * (T + 1) * (T + 1), "malloc tabela batalha");
+    for (int A = 2; A <= T; ++A) {
+        for (int D = 1; D <= T; ++D) {
+            double *out = table + tabelaBatalhaOffset[A][D];
+            memset(grid, 0, sizeof(double) * (T + 1) * (T + 1));
+            grid[A * (T + 1) + D] = 1.0;
+            // estados (a, d) com a >= 2 e d >= 1 ainda lutam; a ordem decrescente
+            // garante que toda a massa de um estado chegou antes de ser repassada
+            for (int a = A; a >= 2; --a) {
+                for (int d = D; d >= 1; --d) {
+                    double m = grid[a * (T + 1) + d];
+                    grid[a * (T + 1) + d - 1] += p * m;
+                    grid[(a - 1) * (T + 1) + d] += q * m;
+                }
+            }
+            double acc = 0.0;
+            for (int i = 0; i < A - 1; ++i) { acc += grid[(A - i) * (T + 1)]; out[i] = acc; }
+            for (int j = 0; j < D; ++j) { acc += grid[1 * (T + 1) + (D - j)]; out[A - 1 + j] = acc; }
+            out[A - 2 + D] = 1.0; // elimina erro de arredondamento no último degrau
+        }
+    }
+    free(grid);
+    tabelaBatalha = table;
+}
+
+/* Monta a tabela uma única vez; pode ser chamada de qualquer thread */
+void inicializarTabelaBatalha(void) {
+    pthread_once(&tabelaBatalhaOnce, montarTabelaBatalha);
+}
+
+/* Probabilidade de A atacantes conquistarem D defensores. Dentro da
+ * tabela é uma consulta; fora dela, a mesma recorrência em O(A * D) com
+ * uma linha de D + 1 posições. A < 2 nunca conquista; D < 1 já está
+ * conquistado. */
+double probabilidadeConquista(int A, int D) {
+    if (A < 2) return 0.0;
+    if (D < 1) return 1.0;
+    if (A <= BATALHA_TABELA_MAX && D <= BATALHA_TABELA_MAX) {
+        inicializarTabelaBatalha();
+        return tabelaBatalha[tabelaBatalhaOffset[A][D] + A - 2];
+    }
+    // row[d] = P(a, d): P(1, d) = 0 e P(a, 0) = 1
+    const double p = BATALHA_P_ATACANTE / 36.0, q = 1.0 - p;
+    double *row = alocar(sizeof(double) * ((size_t)D + 1), "malloc probabilidade");
+    row[0] = 1.0;
+    for (int d = 1; d <= D; ++d) row[d] = 0.0;
+    for (int a = 2; a <= A; ++a)
+        for (int d = 1; d <= D; ++d) row[d] = p * row[d - 1] + q * row[d];
+    double result = row[D];
+    free(row);
+    return result;
+}
+
+/* Resolve a batalha inteira entre 'from' e 'to' (ataque já validado).
+ *
+ * Enquanto um dos lados passa do tamanho da tabela, as rodadas são
+ * sorteadas uma a uma (um sorteio por rodada); daí em diante o resultado
+ * final sai direto da tabela. O sink do tabuleiro recebe um único evento
+ * com as perdas totais (sem dados: attackRoll = defendRoll = 0).
+ * Retorna 1 se o território foi conquistado.
+ */
+int resolverBatalha(Board *b, Rng *rng, Territory *from, Territory *to, CombatResult *out) {
+    inicializarTabelaBatalha();
+    int a = b->armies[from->id], d = b->armies[to->id];
+    CombatResult r = { from->id, to->id, 0, 0, 0, 0, 0 };
+
+    INSTR_INICIO(t0);
+    while (a >= 2 && d >= 1 && (a > BATALHA_TABELA_MAX || d > BATALHA_TABELA_MAX)) {
+        if (rngIntervalo(rng, 36) < BATALHA_P_ATACANTE) --d; else --a;
+    }
+    if (a >= 2 && d >= 1) {
+        const double *cdf = tabelaBatalha + tabelaBatalhaOffset[a][d];
+        double u = (double)(rngProximo(rng) >> 11) * 0x1.0p-53;
+        int lo = 0, hi = a - 2 + d; // primeiro índice com cdf > u
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (cdf[mid] > u) hi = mid; else lo = mid + 1;
+        }
+        if (lo < a - 1) { a -= lo; d = 0; }
+        else { d -= lo - (a - 1); a = 1; }
+    }
+    INSTR_FIM(t0, FASE_DADOS);
+
+    INSTR_INICIO(t1);
+    r.attackerLoss = b->armies[from->id] - a;
+    r.defenderLoss = b->armies[to->id] - d;
+    if (d == 0) {
+        // conquista: 1 exército do atacante ocupa o território
+        definirDono(b, to->id, b->owner[from->id]);
+        definirExercitos(b, from->id, a - 1);
+        definirExercitos(b, to->id, 1);
+        r.attackerLoss += 1;
+        r.conquered = 1;
+    } else {
+        definirExercitos(b, from->id, a);
+        definirExercitos(b, to->id, d);
+    }
+    INSTR_FIM(t1, FASE_CONQUISTA);
+
+    if (out) *out = r;
+    if (b->replay) gravarCombateReplay(b->replay, b, &r);
+    if (b->sink) b->sink(b->sinkCtx, b, &r);
+    return r.conquered;
+}
+
+/* ------------------------------------------------------------------------
+ * Kernel vetorial de batalhas
+ *
+ * Para Monte Carlo (taxa de conquista, vitória de missões) o custo que
+ * sobra é sortear e comparar dados. resolverBatalhasEmLote resolve muitas
+ * batalhas independentes ao mesmo tempo, rodada a rodada: DADOS_LANES
+ * faixas, cada uma com o seu xoshiro256** e a sua batalha, avançam juntas
+ * em laços sem desvios que o compilador vetoriza (com -O2 -march=native:
+ * duas faixas AVX2 ou um registro AVX-512 por operação). Cada sorteio de 64
+ * bits rende duas rodadas; o atacante vence a rodada com
+ * BATALHA_P_ATACANTE/36, sorteado por Lemire sem viés: os raros sorteios
+ * rejeitados viram uma rodada nula, em vez de um novo sorteio com desvio.
+ * Faixas cuja batalha acabou são reabastecidas a cada DADOS_RODADAS
+ * passos. As rodadas são sorteadas uma a uma, então não há limite de
+ * exércitos (a tabela de resolverBatalha vai até BATALHA_TABELA_MAX).
+ * ------------------------------------------------------------------------ */
+
+#define DADOS_LANES 8    // batalhas simultâneas
+#define DADOS_RODADAS 8  // passos vetoriais (2 rodadas cada) entre reabastecimentos
+#define DADOS_LIMIAR 4   // 2^32 mod 36: parte baixa abaixo disso é rejeitada
+
+/* Estados xoshiro256** das faixas (SoA: uma palavra de cada faixa por linha) */
+typedef struct DiceKernel {
+    _Alignas(64) uint64_t s[4][DADOS_LANES];
+} DiceKernel;
+
+/* Semeia as faixas com sequências independentes a partir de 'seed' */
+void iniciarKernelDados(DiceKernel *k, uint64_t seed) {
+    for (int l = 0; l < DADOS_LANES; ++l)
+        for (int i = 0; i < 4; ++i) k->s[i][l] = splitmix64(&seed);
+}
+
+/* Uma rodada em todas as faixas a partir de 32 bits aleatórios por faixa */
+static inline void rodadaLanes(const uint64_t *u, int64_t *restrict a, int64_t *restrict d) {
+    for (int l = 0; l < DADOS_LANES; ++l) {
+        uint64_t m = (u[l] << 5) + (u[l] << 2); // u * 36, só com deslocamentos
+        int64_t live = -(int64_t)((a[l] > 1) & (d[l] > 0) & ((uint32_t)m >= DADOS_LIMIAR));
+        int64_t win = -(int64_t)((m >> 32) < BATALHA_P_ATACANTE);
+        d[l] -= live & win & 1;
+        a[l] -= live & ~win & 1;
+    }
+}
+
+/* Um passo: um sorteio de 64 bits por faixa, duas rodadas */
+static inline void passoLanes(DiceKernel *k, int64_t *restrict a, int64_t *restrict d) {
+    uint64_t *restrict s0 = k->s[0], *restrict s1 = k->s[1], *restrict s2 = k->s[2], *restrict s3 = k->s[3];
+    _Alignas(64) uint64_t hi[DADOS_LANES], lo[DADOS_LANES];
+    for (int l = 0; l < DADOS_LANES; ++l) {
+        uint64_t x = s1[l] + (s1[l] << 2); // s1 * 5
+        x = rotl64(x, 7);
+        uint64_t result = x + (x << 3);    // * 9
+        uint64_t t = s1[l] << 17;
+        s2[l] ^= s0[l];
+        s3[l] ^= s1[l];
+        s1[l] ^= s2[l];
+        s0[l] ^= s3[l];
+        s2[l] ^= t;
+        s3[l] = rotl64(s3[l], 45);
+        hi[l] = result >> 32;
+        lo[l] = result & 0xFFFFFFFFu;
+    }
+    rodadaLanes(hi, a, d);
+    rodadaLanes(lo, a, d);
+}
+
+/* Resolve n batalhas independentes até a conquista ou o recuo (atacante
+ * com 1 exército). attackers[i] e defenders[i] entram com os exércitos de
+ * cada lado e saem com o que restou (defenders[i] == 0: conquista).
+ * Retorna o número de conquistas. */
+long resolverBatalhasEmLote(DiceKernel *k, int32_t *attackers, int32_t *defenders, int n) {
+    INSTR_INICIO(t0);
+    _Alignas(64) int64_t a[DADOS_LANES], d[DADOS_LANES];
+    int slot[DADOS_LANES];
+    int next = 0, busy = 0;
+    long conquered = 0;
+    for (int l = 0; l < DADOS_LANES; ++l) {
+        if (next < n) { slot[l] = next; a[l] = attackers[next]; d[l] = defenders[next]; ++next; ++busy; }
+        else { slot[l] = -1; a[l] = 1; d[l] = 0; }
+    }
+    while (busy) {
+        for (int r = 0; r < DADOS_RODADAS; ++r) passoLanes(k, a, d);
+        // devolve as batalhas encerradas e põe as próximas nas faixas livres
+        for (int l = 0; l < DADOS_LANES; ++l) {
+            if (slot[l] < 0 || (a[l] > 1 && d[l] > 0)) continue;
+            attackers[slot[l]] = (int32_t)a[l];
+            defenders[slot[l]] = (int32_t)d[l];
+            conquered += d[l] == 0;
+            if (next < n) { slot[l] = next; a[l] = attackers[next]; d[l] = defenders[next]; ++next; }
+            else { slot[l] = -1; --busy; }
+        }
+    }
+    INSTR_FIM(t0, FASE_DADOS);
+    return conquered;
+}
+
+/* Estima por Monte Carlo a chance de A atacantes conquistarem D defensores
+ * com 'trials' batalhas no kernel */
+double estimarConquista(DiceKernel *k, int A, int D, long trials) {
+    enum { LOTE = 4096 };
+    int32_t attackers[LOTE], defenders[LOTE];
+    long conquered = 0;
+    for (long done = 0; done < trials;) {
+        int n = trials - done < LOTE ? (int)(trials - done) : LOTE;
+        for (int i = 0; i < n; ++i) { attackers[i] = A; defenders[i] = D; }
+        conquered += resolverBatalhasEmLote(k, attackers, defenders, n);
+        done += n;
+    }
+    return trials ? (double)conquered / (double)trials : 0.0;
+}
+
+/* ------------------------------------------------------------------------
+ * Ataques reversíveis (make/unmake)
+ *
+ * fazerAtaque/fazerBatalha empilham um MoveRecord com o estado anterior dos
+ * dois territórios e resolvem o ataque; desfazerAtaque desempilha e restaura.
+ * Para alpha-beta e MCTS sobre sequências de ataques: cada nível custa um
+ * registro de 24 bytes, sem reconstruir o tabuleiro.
+ * ------------------------------------------------------------------------ */
+
+static void empilharMovimento(Board *b, const Territory *from, const Territory *to) {
+    if (b->nMoves == b->capMoves) {
+        b->capMoves = b->capMoves ? b->capMoves * 2 : 64;
+        b->moves = realocar(b->moves, sizeof(MoveRecord) * b->capMoves, "realloc moves");
+    }
+    MoveRecord *m = &b->moves[b->nMoves++];
+    m->from = from->id;
+    m->to = to->id;
+    m->fromOwner = b->owner[from->id];
+    m->fromArmies = b->armies[from->id];
+    m->toOwner = b->owner[to->id];
+    m->toArmies = b->armies[to->id];
+}
+
+/* resolverAtaque reversível */
+int fazerAtaque(Board *b, Rng *rng, Territory *from, Territory *to, CombatResult *out) {
+    empilharMovimento(b, from, to);
+    return resolverAtaque(b, rng, from, to, out);
+}
+
+/* resolverBatalha reversível */
+int fazerBatalha(Board *b, Rng *rng, Territory *from, Territory *to, CombatResult *out) {
+    empilharMovimento(b, from, to);
+    return resolverBatalha(b, rng, from, to, out);
+}
+
+/* Desfaz o último ataque feito com fazerAtaque/fazerBatalha. Retorna 0 se a
+ * pilha estiver vazia. */
+int desfazerAtaque(Board *b) {
+    if (b->nMoves == 0) return 0;
+    const MoveRecord *m = &b->moves[--b->nMoves];
+    definirDono(b, m->to, m->toOwner);
+    definirExercitos(b, m->to, m->toArmies);
+    definirDono(b, m->from, m->fromOwner);
+    definirExercitos(b, m->from, m->fromArmies);
+    return 1;
+}
+
+/* ------------------------------------------------------------------------
+ * Tabela de transposição
+ *
+ * Ordens de ataque diferentes muitas vezes chegam ao mesmo (dono, exércitos).
+ * A busca guarda a avaliação de cada posição indexada por Board.hash e a
+ * reaproveita quando a mesma posição reaparece. Cada balde tem duas
+ * entradas: uma preferida por profundidade e outra sempre substituída.
+ * ------------------------------------------------------------------------ */
+
+enum { TT_EXATO = 1, TT_LIMITE_INFERIOR, TT_LIMITE_SUPERIOR };
+
+typedef struct TTEntry {
+    uint64_t key;    // hash completo (0 = vazio)
+    int32_t value;   // avaliação da posição
+    int16_t depth;   // profundidade restante da busca que gerou o valor
+    uint8_t flag;    // TT_EXATO / TT_LIMITE_*
+    uint8_t pad;
+} TTEntry;
+
+typedef struct TranspositionTable {
+    TTEntry *entries; // baldes de 2 entradas
+    uint64_t mask;    // número de baldes - 1
+} TranspositionTable;
+
+/* Cria uma tabela com 2^log2Buckets baldes (32 bytes cada) */
+void criarTabelaTransposicao(TranspositionTable *tt, int log2Buckets) {
+    uint64_t buckets = 1ull << log2Buckets;
+    tt->entries = alocar(sizeof(TTEntry) * 2 * buckets, "malloc transposition table");
+    memset(tt->entries, 0, sizeof(TTEntry) * 2 * buckets);
+    tt->mask = buckets - 1;
+}
+
+void liberarTabelaTransposicao(TranspositionTable *tt) {
+    free(tt->entries);
+    tt->entries = NULL;
+}
+
+/* Procura a posição; retorna 1 e copia a entrada para 'out' se achar */
+int ttConsultar(const TranspositionTable *tt, uint64_t key, TTEntry *out) {
+    const TTEntry *bucket = tt->entries + 2 * (key & tt->mask);
+    for (int i = 0; i < 2; ++i) {
+        if (bucket[i].key == key && bucket[i].flag) {
+            *out = bucket[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Grava a avaliação da posição */
+void ttGravar(TranspositionTable *tt, uint64_t key, int value, int depth, int flag) {
+    TTEntry *bucket = tt->entries + 2 * (key & tt->mask);
+    // mesma posição ou profundidade maior vai para a entrada preferida
+    TTEntry *e = (bucket[0].key == key || depth >= bucket[0].depth || !bucket[0].flag)
+                     ? &bucket[0] : &bucket[1];
+    if (e == &bucket[0] && bucket[0].flag && bucket[0].key != key) bucket[1] = bucket[0];
+    e->key = key;
+    e->value = value;
+    e->depth = (int16_t)depth;
+    e->flag = (uint8_t)flag;
+}
+
+/* ------------------------------------------------------------------------
+ * Busca de sequências de ataque
+ *
+ * Profundidade limitada sobre fazerBatalha/desfazerAtaque: em cada nível o
+ * jogador pode parar ou travar mais uma batalha completa (uma amostra dos
+ * dados por ramo). Não há adversário no meio do turno, então não há poda;
+ * o ganho vem da tabela de transposição, já que ordens de ataque
+ * diferentes chegam muitas vezes à mesma posição.
+ *
+ * O valor de um nó é o ganho sobre parar nele (8 por território
+ * conquistado, 1 por exército; perdas contam negativo). Ele não depende da
+ * posição de onde a busca partiu, então a mesma tabela serve para buscas
+ * sucessivas, como no aprofundamento iterativo.
+ * ------------------------------------------------------------------------ */
+
+#define BUSCA_MAX_RAMOS 8        // ataques examinados por nível (os primeiros de gerarAtaques)
+#define BUSCA_VALOR_TERRITORIO 8 // exércitos que um território vale na avaliação
+
+typedef struct AttackSearch {
+    Board *b;
+    Rng *rng;
+    TranspositionTable *tt;
+    int playerId;
+    long nodes;   // posições visitadas
+    long ttHits;  // posições resolvidas pela tabela
+} AttackSearch;
+
+void iniciarBuscaAtaques(AttackSearch *s, Board *b, Rng *rng, TranspositionTable *tt, int playerId) {
+    s->b = b;
+    s->rng = rng;
+    s->tt = tt;
+    s->playerId = playerId;
+    s->nodes = 0;
+    s->ttHits = 0;
+}
+
+/* Variação da avaliação do atacante causada pelo combate 'r' */
+static inline int ganhoCombate(const CombatResult *r) {
+    return r->conquered * (BUSCA_VALOR_TERRITORIO + 1) - r->attackerLoss;
+}
+
+/* Ganho da melhor sequência de até 'depth' batalhas do jogador a partir da
+ * posição atual (0 = parar), com os dados amostrados por s->rng. Com 'best'
+ * não NULL, recebe a primeira batalha dessa sequência (from = -1 se parar
+ * for o melhor). O tabuleiro volta ao estado em que estava. */
+int buscarAtaque(AttackSearch *s, int depth, Attack *best) {
+    Board *b = s->b;
+    uint64_t key = b->hash ^ zobristMix((uint64_t)(uint32_t)s->playerId);
+    TTEntry e;
+    s->nodes++;
+    if (!best && ttConsultar(s->tt, key, &e) && e.depth >= depth) {
+        s->ttHits++;
+        return e.value;
+    }
+    int value = 0;
+    if (best) best->from = best->to = -1;
+    if (depth > 0) {
+        Attack attacks[BUSCA_MAX_RAMOS];
+        int n = gerarAtaques(b, s->playerId, attacks, BUSCA_MAX_RAMOS);
+        if (n > BUSCA_MAX_RAMOS) n = BUSCA_MAX_RAMOS;
+        for (int i = 0; i < n; ++i) {
+            CombatResult r;
+            fazerBatalha(b, s->rng, b->territories[attacks[i].from], b->territories[attacks[i].to], &r);
+            int v = ganhoCombate(&r) + buscarAtaque(s, depth - 1, NULL);
+            desfazerAtaque(b);
+            if (v > value) {
+                value = v;
+                if (best) *best = attacks[i];
+            }
+        }
+    }
+    ttGravar(s->tt, key, value, depth, TT_EXATO);
+    return value;
+}
+
+/* Sink que imprime cada combate no terminal (modo interativo) */
+void imprimirCombate(void *ctx, const Board *b, const CombatResult *r) {
+    (void)ctx;
+    const Territory *from = b->territories[r->from];
+    const Territory *to = b->territories[r->to];
+    if (r->attackRoll) // batalhas completas não têm dados individuais
+        printf("Rolagem atacante: %d | defensor: %d\n", r->attackRoll, r->defendRoll);
+    if (r->conquered) {
+        printf("Território %s conquistado!\n", nomeTerritorio(to));
+    } else if (r->defenderLoss) {
+        printf("%s perde %d exército%s (restam %d)\n", nomeTerritorio(to), r->defenderLoss,
+               r->defenderLoss == 1 ? "" : "s", b->armies[r->to]);
+    } else {
+        printf("%s perde %d exército%s (restam %d)\n", nomeTerritorio(from), r->attackerLoss,
+               r->attackerLoss == 1 ? "" : "s", b->armies[r->from]);
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Logger assíncrono
+ *
+ * As threads do jogo só copiam registros (texto já formatado ou um combate
+ * estruturado) para um anel de tamanho fixo, sem locks: é a fila limitada
+ * de Vyukov, em que cada posição tem um número de sequência que diz se ela
+ * está livre ou pronta. Uma thread de descarga esvazia o anel, formata os
+ * combates e grava em lotes com write(), de modo que um terminal ou pipe
+ * lento nunca trava o laço do jogo. Com o anel cheio, LOG_DESCARTAR perde o
+ * registro (e conta) e LOG_ESPERAR cede a CPU até haver espaço.
+ * ------------------------------------------------------------------------ */
+
+#define LOG_TEXTO_MAX 232        // bytes de texto por registro (truncado além disso)
+#define LOG_BUFFER_ESCRITA 65536 // bytes acumulados por write()
+
+typedef enum LogPolicy {
+    LOG_DESCARTAR = 0,  // anel cheio: descarta (nunca bloqueia o jogo)
+    LOG_ESPERAR         // anel cheio: espera a thread de descarga
+} LogPolicy;
+
+enum {
+    LOG_TEXTO = 1,
+    LOG_COMBATE
+};
+
+/* Um registro do anel: texto pronto ou combate a formatar na descarga */
+typedef struct LogRecord {
+    uint16_t kind;
+    uint16_t len;
+    union {
+        char text[LOG_TEXTO_MAX];
+        struct {
+            CombatResult r;
+            uint32_t fromName, toName; // ids de string (a tabela vive o processo todo)
+            int fromArmies, toArmies;  // exércitos depois do combate
+        } combat;
+    };
+} LogRecord;
+
+typedef struct LogSlot {
+    atomic_size_t seq;  // == posição: livre; == posição + 1: pronto para ler
+    LogRecord rec;
+} LogSlot;
+
+typedef struct Logger {
+    LogSlot *slots;
+    size_t mask;
+    _Alignas(64) atomic_size_t enqueuePos;  // disputado pelos produtores
+    _Alignas(64) size_t dequeuePos;         // só a thread de descarga
+    atomic_int stop;
+    atomic_long dropped;
+    LogPolicy policy;
+    int fd;
+    pthread_t thread;
+} Logger;
+
+/* Formata um registro para o buffer de saída; retorna os bytes escritos */
+static size_t formatarRegistro(const LogRecord *rec, char *out, size_t cap) {
+    if (rec->kind == LOG_TEXTO) {
+        memcpy(out, rec->text, rec->len);
+        return rec->len;
+    }
+    const CombatResult *r = &rec->combat.r;
+    int n = 0;
+    if (r->attackRoll)
+        n += snprintf(out + n, cap - n, "Rolagem atacante: %d | defensor: %d\n", r->attackRoll, r->defendRoll);
+    if (r->conquered) {
+        n += snprintf(out + n, cap - n, "Território %s conquistado!\n", textoString(rec->combat.toName));
+    } else if (r->defenderLoss) {
+        n += snprintf(out + n, cap - n, "%s perde %d exército%s (restam %d)\n", textoString(rec->combat.toName),
+                      r->defenderLoss, r->defenderLoss == 1 ? "" : "s", rec->combat.toArmies);
+    } else {
+        n += snprintf(out + n, cap - n, "%s perde %d exército%s (restam %d)\n", textoString(rec->combat.fromName),
+                      r->attackerLoss, r->attackerLoss == 1 ? "" : "s", rec->combat.fromArmies);
+    }
+    return (size_t)n < cap ? (size_t)n : cap - 1;
+}
+
+static void escreverTudo(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t w = write(fd, buf, len);
+        if (w < 0) {
+            perror("write log");
+            return;
+        }
+        buf += w;
+        len -= (size_t)w;
+    }
+}
+
+static void *threadLogger(void *arg) {
+    Logger *lg = arg;
+    char *out = alocar(LOG_BUFFER_ESCRITA, "malloc log");
+    size_t used = 0;
+    for (;;) {
+        int stopping = atomic_load_explicit(&lg->stop, memory_order_acquire);
+        int drained = 0;
+        for (;;) {
+            LogSlot *s = &lg->slots[lg->dequeuePos & lg->mask];
+            if (atomic_load_explicit(&s->seq, memory_order_acquire) != lg->dequeuePos + 1) break;
+            if (LOG_BUFFER_ESCRITA - used < LOG_TEXTO_MAX * 2) {
+                escreverTudo(lg->fd, out, used);
+                used = 0;
+            }
+            used += formatarRegistro(&s->rec, out + used, LOG_BUFFER_ESCRITA - used);
+            atomic_store_explicit(&s->seq, lg->dequeuePos + lg->mask + 1, memory_order_release);
+            lg->dequeuePos++;
+            drained = 1;
+        }
+        if (used) {
+            escreverTudo(lg->fd, out, used); // um write por lote
+            used = 0;
+        }
+        if (stopping) break; // 'stop' foi lido antes desta última passada
+        if (!drained) nanosleep(&(struct timespec){ 0, 200000 }, NULL);
+    }
+    free(out);
+    return NULL;
+}
+
+/* Inicia o logger sobre 'fd' com 2^log2Slots registros no anel */
+void iniciarLogger(Logger *lg, int fd, int log2Slots, LogPolicy policy) {
+    size_t n = (size_t)1 << log2Slots;
+    lg->slots = alocar(sizeof(LogSlot) * n, "malloc log");
+    for (size_t i = 0; i < n; ++i) atomic_init(&lg->slots[i].seq, i);
+    lg->mask = n - 1;
+    atomic_init(&lg->enqueuePos, 0);
+    lg->dequeuePos = 0;
+    atomic_init(&lg->stop, 0);
+    atomic_init(&lg->dropped, 0);
+    lg->policy = policy;
+    lg->fd = fd;
+    if (pthread_create(&lg->thread, NULL, threadLogger, lg) != 0) {
+        perror("pthread_create");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Reserva uma posição do anel (NULL se cheio e a política for descartar).
+ * O registro só fica visível em publicarRegistro. */
+static LogSlot *reservarRegistro(Logger *lg, size_t *pos) {
+    size_t p = atomic_load_explicit(&lg->enqueuePos, memory_order_relaxed);
+    for (;;) {
+        LogSlot *s = &lg->slots[p & lg->mask];
+        size_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)p;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&lg->enqueuePos, &p, p + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *pos = p;
+                return s;
+            }
+        } else if (diff < 0) {
+            // cheio: a posição ainda não foi lida na volta anterior
+            if (lg->policy == LOG_DESCARTAR) {
+                atomic_fetch_add_explicit(&lg->dropped, 1, memory_order_relaxed);
+                return NULL;
+            }
+            sched_yield();
+            p = atomic_load_explicit(&lg->enqueuePos, memory_order_relaxed);
+        } else {
+            p = atomic_load_explicit(&lg->enqueuePos, memory_order_relaxed);
+        }
+    }
+}
+
+static inline void publicarRegistro(LogSlot *s, size_t pos) {
+    atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+}
+
+/* Enfileira uma linha de texto formatada no estilo printf */
+void logTexto(Logger *lg, const char *fmt, ...) {
+    size_t pos;
+    LogSlot *s = reservarRegistro(lg, &pos);
+    if (!s) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(s->rec.text, LOG_TEXTO_MAX, fmt, ap);
+    va_end(ap);
+    s->rec.kind = LOG_TEXTO;
+    s->rec.len = (uint16_t)(n < 0 ? 0 : n < LOG_TEXTO_MAX ? n : LOG_TEXTO_MAX - 1);
+    publicarRegistro(s, pos);
+}
+
+/* Sink de combate assíncrono (ctx = Logger): copia o resultado e os dados
+ * necessários; a formatação acontece na thread de descarga */
+void registrarCombateLog(void *ctx, const Board *b, const CombatResult *r) {
+    Logger *lg = ctx;
+    size_t pos;
+    LogSlot *s = reservarRegistro(lg, &pos);
+    if (!s) return;
+    s->rec.kind = LOG_COMBATE;
+    s->rec.combat.r = *r;
+    s->rec.combat.fromName = b->territories[r->from]->nameId;
+    s->rec.combat.toName = b->territories[r->to]->nameId;
+    s->rec.combat.fromArmies = b->armies[r->from];
+    s->rec.combat.toArmies = b->armies[r->to];
+    publicarRegistro(s, pos);
+}
+
+/* Descarrega tudo o que foi enfileirado, encerra a thread e libera o anel.
+ * Retorna quantos registros foram descartados por anel cheio. */
+long encerrarLogger(Logger *lg) {
+    atomic_store_explicit(&lg->stop, 1, memory_order_release);
+    pthread_join(lg->thread, NULL);
+    free(lg->slots);
+    lg->slots = NULL;
+    long dropped = atomic_load_explicit(&lg->dropped, memory_order_relaxed);
+    if (dropped) fprintf(stderr, "logger: %ld registros descartados (anel cheio)\n", dropped);
+    return dropped;
+}
+
+/* Copia dono e exércitos de 'src' para 'dst' (mesma topologia). Cópia em
+ * bloco: não passa pelo log de desfazer, então não deve haver snapshot
+ * aberto em 'dst'. */
+void copiarEstado(Board *dst, const Board *src) {
+    memcpy(dst->owner, src->owner, sizeof(int) * src->nTerritories);
+    memcpy(dst->armies, src->armies, sizeof(int) * src->nTerritories);
+    memcpy(dst->ownerCount, src->ownerCount, sizeof(int) * (src->nPlayers + 1));
+    memcpy(dst->regionOwnerCount, src->regionOwnerCount,
+           sizeof(int) * (size_t)src->nRegions * (src->nPlayers + 1));
+    memcpy(dst->playerBonus, src->playerBonus, sizeof(int) * (src->nPlayers + 1));
+    memcpy(dst->enemyCount, src->enemyCount, sizeof(int) * src->nTerritories);
+    memcpy(dst->frontierBits, src->frontierBits,
+           sizeof(uint64_t) * (size_t)(src->nPlayers + 1) * src->frontierWords);
+    memcpy(dst->frontierCount, src->frontierCount, sizeof(int) * (src->nPlayers + 1));
+    memcpy(dst->ufNode, src->ufNode, sizeof(int) * src->nTerritories);
+    memcpy(dst->ufParent, src->ufParent, sizeof(int) * src->ufNodes);
+    memcpy(dst->ufSize, src->ufSize, sizeof(int) * src->ufNodes);
+    dst->ufNodes = src->ufNodes;
+    memcpy(dst->largestComponent, src->largestComponent, sizeof(int) * (src->nPlayers + 1));
+    memcpy(dst->largestStale, src->largestStale, (size_t)src->nPlayers + 1);
+    dst->hash = src->hash;
+}
+
+/* Cria em 'dst' um clone do tabuleiro finalizado 'src'. A topologia
+ * (territórios, regiões, CSR, índice de adjacência) é compartilhada e só
+ * pode ser lida; dono, exércitos e contadores são copiados para a arena do
+ * clone. O modelo precisa continuar vivo enquanto o clone existir. */
+void clonarTabuleiro(Board *dst, const Board *src) {
+    *dst = *src;
+    // bloco do tamanho do estado: milhares de clones não pagam 64 KB cada
+    size_t estado = 64 * (size_t)src->nTerritories +
+                    8 * (size_t)(src->nPlayers + 1) * ((size_t)src->frontierWords + src->nRegions + 8);
+    arenaInit(&dst->arena, estado < 4096 ? 4096 : estado);
+    dst->arena.pooled = src->arena.pooled; // clones de um modelo em pool também usam o pool
+    dst->shared = 1;
+    dst->replay = NULL; // gravação é só do tabuleiro original
+    dst->undoLog = NULL; // cada clone tem seu próprio log de desfazer
+    dst->undoLen = dst->undoCap = dst->undoDepth = 0;
+    dst->moves = NULL;
+    dst->nMoves = dst->capMoves = 0;
+    dst->capTerritories = src->nTerritories;
+    dst->owner = arenaAlloc(&dst->arena, sizeof(int) * (src->nTerritories ? src->nTerritories : 1));
+    dst->armies = arenaAlloc(&dst->arena, sizeof(int) * (src->nTerritories ? src->nTerritories : 1));
+    alocarContadores(dst);
+    copiarEstado(dst, src);
+}
+
+/* ------------------------------------------------------------------------
+ * Estado compacto
+ *
+ * O estado quente de um território é só dono e exércitos. PackedState guarda
+ * os dois em 3 bytes por território (exércitos uint16, dono uint8; o id é a
+ * posição) num único bloco, então um mapa de 1k territórios ocupa 3 KB e um
+ * snapshot é um memcpy. Serve para guardar nós de busca e posições de
+ * simulação; para jogar, aplicarEstadoCompacto leva o estado de volta a um
+ * tabuleiro pelo caminho normal (definirDono/definirExercitos), mantendo
+ * contadores, fronteiras, componentes e log de desfazer corretos.
+ * ------------------------------------------------------------------------ */
+
+#define COMPACTO_MAX_DONO UINT8_MAX
+#define COMPACTO_MAX_EXERCITOS UINT16_MAX
+
+typedef struct PackedState {
+    int nTerritories;
+    uint64_t hash;      // hash Zobrist do tabuleiro empacotado
+    uint16_t *armies;   // [n], início do bloco
+    uint8_t *owner;     // [n], logo depois de 'armies'
+} PackedState;
+
+/* Bytes do bloco de um estado com n territórios */
+static inline size_t tamanhoEstadoCompacto(int n) {
+    return (sizeof(uint16_t) + sizeof(uint8_t)) * (size_t)n;
+}
+
+/* Aloca um estado compacto para tabuleiros com a topologia de 'b' */
+void criarEstadoCompacto(PackedState *s, const Board *b) {
+    int n = b->nTerritories;
+    s->nTerritories = n;
+    s->hash = 0;
+    s->armies = alocar(tamanhoEstadoCompacto(n ? n : 1), "malloc estado compacto");
+    s->owner = (uint8_t *)(s->armies + n);
+}
+
+void liberarEstadoCompacto(PackedState *s) {
+    free(s->armies);
+    s->armies = NULL;
+    s->owner = NULL;
+}
+
+/* Empacota o estado de 'b' em 's'. Retorna 0 (com 's' indefinido) se algum
+ * dono passar de COMPACTO_MAX_DONO ou algum exército de
+ * COMPACTO_MAX_EXERCITOS. */
+int empacotarEstado(const Board *b, PackedState *s) {
+    const int *restrict owner = b->owner;
+    const int *restrict armies = b->armies;
+    uint16_t *restrict outArmies = s->armies;
+    uint8_t *restrict outOwner = s->owner;
+    unsigned overflow = 0;
+    for (int i = 0; i < s->nTerritories; ++i) {
+        overflow |= ((unsigned)owner[i] > COMPACTO_MAX_DONO) | ((unsigned)armies[i] > COMPACTO_MAX_EXERCITOS);
+        outArmies[i] = (uint16_t)armies[i];
+        outOwner[i] = (uint8_t)owner[i];
+    }
+    s->hash = b->hash;
+    return !overflow;
+}
+
+/* Snapshot de um estado compacto em outro (mesma topologia) */
+static inline void copiarEstadoCompacto(PackedState *dst, const PackedState *src) {
+    memcpy(dst->armies, src->armies, tamanhoEstadoCompacto(src->nTerritories));
+    dst->hash = src->hash;
+}
+
+/* 1 se os dois estados são iguais */
+static inline int estadoCompactoIgual(const PackedState *a, const PackedState *b) {
+    return a->hash == b->hash && memcmp(a->armies, b->armies, tamanhoEstadoCompacto(a->nTerritories)) == 0;
+}
+
+/* Leva o estado 's' para o tabuleiro 'b' (mesma topologia). Só os
+ * territórios que mudaram passam por definirDono/definirExercitos, então o
+ * custo é uma varredura de 3 bytes por território mais O(alterações), e um
+ * snapshot aberto em 'b' pode desfazer tudo. */
+void aplicarEstadoCompacto(Board *b, const PackedState *s) {
+    for (int i = 0; i < s->nTerritories; ++i) {
+        if (b->owner[i] != s->owner[i]) definirDono(b, i, s->owner[i]);
+        if (b->armies[i] != s->armies[i]) definirExercitos(b, i, s->armies[i]);
+    }
+}
+
+/* Função pedida: libera toda a memória alocada para territórios e missões.
+ *
+ * Territórios, adjacência CSR e missões vivem na arena do tabuleiro (nomes e
+ * descrições ficam na tabela global de strings, que dura o processo todo),
+ * então basta um único reset (mais os arrays indexados por id e as arestas
+ * pendentes, se o mapa não foi finalizado). A arena mantém um bloco para
+ * reaproveitar na próxima partida; use arenaDestroy para devolvê-lo ao
+ * sistema (ou ao pool global, se a arena estiver em modo pool).
+ * liberarMemoriaAdiada faz o mesmo numa thread de fundo.
+ *
+ * Importante: após a chamada, todos os ponteiros obtidos do tabuleiro ficam inválidos.
+ * Em um clone, só a memória do próprio clone é liberada.
+ */
+void liberarMemoria(Board *b) {
+    if (!b->shared) {
+        // em clones estes arrays pertencem ao modelo ou à arena do clone
+        free(b->territories);
+        if (b->mapBase) {
+            munmap(b->mapBase, b->mapSize); // owner, armies, region e CSR moram no arquivo
+        } else {
+            free(b->owner);
+            free(b->armies);
+            free(b->region);
+            free(b->regionNames);
+            free(b->regionBonus);
+        }
+    }
+    free(b->edgeFrom);
+    free(b->edgeTo);
+    free(b->undoLog);
+    free(b->moves);
+    Arena arena = b->arena;
+    arenaReset(&arena);
+    memset(b, 0, sizeof(*b));
+    b->arena = arena;
+}
+
+/* ------------------------------------------------------------------------
+ * Liberação em segundo plano
+ *
+ * Em partidas gigantes, liberar tudo (munmap, arrays por id, blocos da
+ * arena) aparece na latência de quem encerra a partida. liberarMemoriaAdiada
+ * só move o tabuleiro para uma fila e retorna; uma thread de fundo, criada
+ * na primeira chamada, faz liberarMemoria + arenaDestroy em ordem de
+ * chegada. aguardarLiberacoes espera a fila esvaziar (antes de medir
+ * memória ou de encerrar o processo).
+ * ------------------------------------------------------------------------ */
+
+/* Tabuleiro esperando a thread de liberação */
+typedef struct TeardownItem {
+    Board board;
+    struct TeardownItem *next;
+} TeardownItem;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;   // há item na fila
+    pthread_cond_t done;   // a fila esvaziou
+    TeardownItem *head, *tail;
+    long pending;          // itens enfileirados ou em liberação
+    int started;
+    pthread_t thread;
+} liberador = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                NULL, NULL, 0, 0, 0 };
+
+static void *threadLiberador(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&liberador.lock);
+    for (;;) {
+        while (!liberador.head) pthread_cond_wait(&liberador.wake, &liberador.lock);
+        TeardownItem *it = liberador.head;
+        liberador.head = it->next;
+        if (!liberador.head) liberador.tail = NULL;
+        pthread_mutex_unlock(&liberador.lock);
+
+        liberarMemoria(&it->board);
+        arenaDestroy(&it->board.arena);
+        free(it);
+
+        pthread_mutex_lock(&liberador.lock);
+        if (--liberador.pending == 0) pthread_cond_broadcast(&liberador.done);
+    }
+    return NULL;
+}
+
+/* liberarMemoria em segundo plano: retorna na hora, com 'b' vazio como
+ * depois de liberarMemoria, mas com uma arena nova (os blocos antigos vão
+ * junto para a thread de fundo). Um clone adiado exige que o modelo viva
+ * até aguardarLiberacoes. */
+void liberarMemoriaAdiada(Board *b) {
+    TeardownItem *it = alocar(sizeof(TeardownItem), "malloc liberação");
+    it->board = *b;
+    it->next = NULL;
+    Arena arena;
+    arenaInit(&arena, b->arena.blockSize);
+    arena.pooled = b->arena.pooled;
+    memset(b, 0, sizeof(*b));
+    b->arena = arena;
+
+    pthread_mutex_lock(&liberador.lock);
+    if (!liberador.started) {
+        if (pthread_create(&liberador.thread, NULL, threadLiberador, NULL) != 0) {
+            // sem thread de fundo: libera aqui mesmo
+            pthread_mutex_unlock(&liberador.lock);
+            liberarMemoria(&it->board);
+            arenaDestroy(&it->board.arena);
+            free(it);
+            return;
+        }
+        pthread_detach(liberador.thread);
+        liberador.started = 1;
+    }
+    if (liberador.tail) liberador.tail->next = it; else liberador.head = it;
+    liberador.tail = it;
+    liberador.pending++;
+    pthread_cond_signal(&liberador.wake);
+    pthread_mutex_unlock(&liberador.lock);
+}
+
+/* Espera todas as liberações adiadas terminarem */
+void aguardarLiberacoes(void) {
+    pthread_mutex_lock(&liberador.lock);
+    while (liberador.pending) pthread_cond_wait(&liberador.done, &liberador.lock);
+    pthread_mutex_unlock(&liberador.lock);
+}
+
+/* ------------------------------------------------------------------------
+ * Consultas no grafo
+ *
+ * Buscas em largura sobre o CSR com buffers alocados uma única vez por
+ * GraphQuery: a fila e as distâncias têm nTerritories posições e "visitado"
+ * é um carimbo por território (trocar de busca é incrementar o carimbo, sem
+ * limpar nada). Conectividade restrita a um dono (alcancavel,
+ * maiorComponente) não precisa de busca: ver Componentes por dono.
+ * ------------------------------------------------------------------------ */
+
+/* Buffers de busca sobre um tabuleiro */
+typedef struct GraphQuery {
+    const Board *b;
+    int *queue;               // fila da BFS (nTerritories posições)
+    int *dist;                // distância da última busca (válida se visit == stamp)
+    uint32_t *visit;          // carimbo da busca que visitou cada id
+    uint32_t stamp;
+} GraphQuery;
+
+/* Prepara os buffers para o tabuleiro finalizado 'b' (o tabuleiro precisa
+ * continuar vivo). Liberar com liberarConsultaGrafo. */
+void criarConsultaGrafo(GraphQuery *q, const Board *b) {
+    size_t n = b->nTerritories ? (size_t)b->nTerritories : 1;
+    q->b = b;
+    q->queue = alocar(sizeof(int) * n, "malloc graph query");
+    q->dist = alocar(sizeof(int) * n, "malloc graph query");
+    q->visit = alocar(sizeof(uint32_t) * n, "malloc graph query");
+    memset(q->visit, 0, sizeof(uint32_t) * n);
+    q->stamp = 0;
+}
+
+void liberarConsultaGrafo(GraphQuery *q) {
+    free(q->queue);
+    free(q->dist);
+    free(q->visit);
+    memset(q, 0, sizeof(*q));
+}
+
+/* Começa uma nova busca: invalida todas as marcas de visitado em O(1) */
+static inline void novaBusca(GraphQuery *q) {
+    if (++q->stamp == 0) {
+        // carimbo deu a volta: limpa uma vez a cada 2^32 buscas
+        memset(q->visit, 0, sizeof(uint32_t) * (q->b->nTerritories ? q->b->nTerritories : 1));
+        q->stamp = 1;
+    }
+}
+
+static inline int visitado(const GraphQuery *q, int id) {
+    return q->visit[id] == q->stamp;
+}
+
+/* BFS a partir de várias origens (todas com distância 0). Só atravessa
+ * territórios do dono 'viaOwner' (-1 = qualquer um); territórios de outro
+ * dono são alcançados, mas não expandidos. Para em 'maxDist' (-1 = sem
+ * limite). Retorna quantos territórios foram alcançados; consulte com
+ * distanciaBusca. */
+int buscaLargura(GraphQuery *q, const int *sources, int nSources, int viaOwner, int maxDist) {
+    const Board *b = q->b;
+    novaBusca(q);
+    int head = 0, tail = 0;
+    for (int s = 0; s < nSources; ++s) {
+        int id = sources[s];
+        if (visitado(q, id)) continue;
+        q->visit[id] = q->stamp;
+        q->dist[id] = 0;
+        q->queue[tail++] = id;
+    }
+    while (head < tail) {
+        int u = q->queue[head++];
+        if (maxDist >= 0 && q->dist[u] >= maxDist) continue;
+        if (viaOwner >= 0 && q->dist[u] > 0 && b->owner[u] != viaOwner) continue;
+        for (int e = b->adjOffsets[u]; e < b->adjOffsets[u + 1]; ++e) {
+            int v = b->adjList[e];
+            if (visitado(q, v)) continue;
+            q->visit[v] = q->stamp;
+            q->dist[v] = q->dist[u] + 1;
+            q->queue[tail++] = v;
+        }
+    }
+    return tail;
+}
+
+/* Distância de 'id' na última busca, ou -1 se não foi alcançado (válida até a
+ * próxima consulta com o mesmo GraphQuery) */
+static inline int distanciaBusca(const GraphQuery *q, int id) {
+    return visitado(q, id) ? q->dist[id] : -1;
+}
+
+/* Território mais próximo de 'from' cujo dono é 'targetOwner' (-1 = qualquer
+ * dono diferente do de 'from'), andando por qualquer território. Retorna o
+ * id (empates: o primeiro na ordem da BFS) ou -1; 'dist' recebe a
+ * distância, se não for NULL. */
+int inimigoMaisProximo(GraphQuery *q, int from, int targetOwner, int *dist) {
+    const Board *b = q->b;
+    int me = b->owner[from];
+    novaBusca(q);
+    int head = 0, tail = 0;
+    q->visit[from] = q->stamp;
+    q->dist[from] = 0;
+    q->queue[tail++] = from;
+    while (head < tail) {
+        int u = q->queue[head++];
+        int owner = b->owner[u];
+        if (u != from && (targetOwner < 0 ? owner != me : owner == targetOwner)) {
+            if (dist) *dist = q->dist[u];
+            return u;
+        }
+        for (int e = b->adjOffsets[u]; e < b->adjOffsets[u + 1]; ++e) {
+            int v = b->adjList[e];
+            if (visitado(q, v)) continue;
+            q->visit[v] = q->stamp;
+            q->dist[v] = q->dist[u] + 1;
+            q->queue[tail++] = v;
+        }
+    }
+    return -1;
+}
+
+/* ------------------------------------------------------------------------
+ * Fase de reforço
+ *
+ * Cada jogador recebe max(3, territórios / 2) exércitos mais os bônus dos
+ * continentes que controla (ambos contadores O(1) do tabuleiro) e os coloca
+ * na sua fronteira: territórios dele vizinhos de algum inimigo, mantidos
+ * por definirDono (ver Fronteiras). Por isso o reforço custa O(fronteira),
+ * não O(V + E).
+ * ------------------------------------------------------------------------ */
+
+#define REFORCO_MINIMO 3
+
+/* Resultado do cálculo de reforços de todos os jogadores */
+typedef struct ReinforcementPlan {
+    int *income;          // exércitos a receber por jogador [0..nPlayers]
+    int *frontierCount;   // territórios de fronteira por jogador
+    int nPlayers;
+} ReinforcementPlan;
+
+/* Exércitos que o jogador recebe no reforço, em O(1) */
+static inline int reforcoJogador(const Board *b, int playerId) {
+    int base = b->ownerCount[playerId] / 2;
+    if (b->ownerCount[playerId] == 0) return 0;
+    return (base < REFORCO_MINIMO ? REFORCO_MINIMO : base) + bonusContinentes(b, playerId);
+}
+
+/* Calcula a renda e o tamanho da fronteira de todos os jogadores, em
+ * O(jogadores). Liberar com liberarPlanoReforco. */
+void calcularReforcos(const Board *b, ReinforcementPlan *plan) {
+    int stride = b->nPlayers + 1;
+    plan->nPlayers = b->nPlayers;
+    plan->income = alocar(sizeof(int) * stride, "malloc plan");
+    plan->frontierCount = alocar(sizeof(int) * stride, "malloc plan");
+    for (int p = 0; p < stride; ++p) {
+        plan->income[p] = p ? reforcoJogador(b, p) : 0;
+        plan->frontierCount[p] = b->frontierCount[p];
+    }
+}
+
+void liberarPlanoReforco(ReinforcementPlan *plan) {
+    free(plan->income);
+    free(plan->frontierCount);
+    plan->income = plan->frontierCount = NULL;
+}
+
+/* Distribui 'armies' exércitos do jogador, um a um, em territórios de
+ * fronteira sorteados. Sem fronteira, vão para um território qualquer dele.
+ * 'scratch' precisa de espaço para nTerritories ids. */
+static void colocarExercitos(Board *b, Rng *rng, int playerId, int armies, int *scratch) {
+    if (armies <= 0) return;
+    int nFrontier = listarFronteiraJogador(b, playerId, scratch);
+    if (nFrontier == 0) {
+        for (int i = 0; i < b->nTerritories; ++i) {
+            if (b->owner[i] == playerId) {
+                definirExercitos(b, i, b->armies[i] + armies);
+                if (b->replay) gravarReforcoReplay(b->replay, b, i);
+                return;
+            }
+        }
+        return;
+    }
+    for (int k = 0; k < armies; ++k) {
+        int id = scratch[rngIntervalo(rng, (uint32_t)nFrontier)];
+        definirExercitos(b, id, b->armies[id] + 1);
+        if (b->replay) gravarReforcoReplay(b->replay, b, id);
+    }
+}
+
+/* Aplica o reforço de um jogador a partir de um plano já calculado */
+void aplicarReforcos(Board *b, Rng *rng, int playerId, const ReinforcementPlan *plan, int *scratch) {
+    colocarExercitos(b, rng, playerId, plan->income[playerId], scratch);
+}
+
+/* Reforço de um único jogador com a renda atual (usado a cada turno pelo
+ * simulador) */
+void reforcarJogador(Board *b, Rng *rng, int playerId, int *scratch) {
+    colocarExercitos(b, rng, playerId, reforcoJogador(b, playerId), scratch);
+}
+
+/* ------------------------------------------------------------------------
+ * Formato binário de mapa (carregado com mmap, sem cópia)
+ *
+ * Layout, com todas as seções alinhadas a 64 bytes e em ordem de bytes
+ * nativa (byteOrder detecta arquivos de outra arquitetura):
+ *
+ *   MapFileHeader
+ *   nomes      : strings terminadas em '\0', concatenadas
+ *   nameOffset : uint32[n]  posição do nome de cada território em 'nomes'
+ *   owner      : int32[n]
+ *   armies     : int32[n]
+ *   region     : int32[n]  (-1 = sem região; regiões em faixas contíguas de ids)
+ *   regionName : uint32[nRegions]  posição do nome de cada região em 'nomes'
+ *   regionBonus: int32[nRegions]
+ *   adjOffsets : int32[n + 1]  CSR
+ *   adjList    : int32[E]
+ *   adjIndex   : bitset (n x adjWords palavras) ou hash de arestas (adjHashMask + 1)
+ *
+ * O arquivo é mapeado com MAP_PRIVATE: dono e exércitos são usados no lugar
+ * e escritas viram cópias privadas das páginas, sem alterar o arquivo. Os
+ * arrays nunca são copiados, mas a carga ainda faz passadas O(n + E):
+ * valida donos, CSR, índice e simetria, monta as visões Territory, interna os nomes e
+ * recalcula hash, contadores, fronteiras e componentes. O CSR reverso só é
+ * montado em mapas dirigidos: o cabeçalho diz se o grafo é simétrico e
+ * guarda o grau máximo.
+ * ------------------------------------------------------------------------ */
+
+#define MAPA_MAGIC "WARMAP\0\0"
+#define MAPA_VERSAO 4
+#define MAPA_ALINHAMENTO 64
+#define MAPA_SIMETRICO 1u // flags: entrada e saída de cada território coincidem
+#define MAPA_PREFETCH_LINHAS 8 // linhas CSR adiantadas na conferência do índice hash
+
+typedef struct MapFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;     // 0x01020304 na ordem de quem gravou
+    uint32_t nTerritories;
+    uint32_t nEdges;
+    uint32_t nPlayers;
+    uint32_t adjIndexMode;  // ADJ_INDICE_BITSET ou ADJ_INDICE_HASH
+    uint32_t adjWords;
+    uint32_t nRegions;
+    uint32_t flags;         // MAPA_*
+    uint32_t maxDegree;     // maior grau de saída + entrada
+    uint64_t adjHashMask;
+    uint64_t offNames, sizeNames;
+    uint64_t offNameOffsets;
+    uint64_t offOwner;
+    uint64_t offArmies;
+    uint64_t offRegion;
+    uint64_t offRegionNames;
+    uint64_t offRegionBonus;
+    uint64_t offAdjOffsets;
+    uint64_t offAdjList;
+    uint64_t offAdjIndex, sizeAdjIndex;
+    uint64_t fileSize;
+} MapFileHeader;
+
+static uint64_t alinharMapa(uint64_t off) {
+    return (off + MAPA_ALINHAMENTO - 1) & ~(uint64_t)(MAPA_ALINHAMENTO - 1);
+}
+
+/* Grava 'size' bytes em 'off', completando com zeros até lá */
+static int gravarSecao(FILE *f, uint64_t *pos, uint64_t off, const void *data, size_t size) {
+    static const char zeros[MAPA_ALINHAMENTO];
+    while (*pos < off) {
+        size_t pad = off - *pos < sizeof(zeros) ? (size_t)(off - *pos) : sizeof(zeros);
+        if (fwrite(zeros, 1, pad, f) != pad) return 0;
+        *pos += pad;
+    }
+    if (size && fwrite(data, 1, size, f) != size) return 0;
+    *pos += size;
+    return 1;
+}
+
+/* Grava o tabuleiro finalizado no formato binário. Retorna 1 em sucesso. */
+int salvarMapaBinario(const Board *b, const char *path) {
+    if (!b->finalized) {
+        fprintf(stderr, "salvarMapaBinario: mapa não finalizado\n");
+        return 0;
+    }
+    uint32_t n = (uint32_t)b->nTerritories;
+    MapFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAPA_MAGIC, sizeof(h.magic));
+    h.version = MAPA_VERSAO;
+    h.byteOrder = 0x01020304;
+    h.nTerritories = n;
+    h.nEdges = (uint32_t)b->adjOffsets[n];
+    h.nPlayers = (uint32_t)b->nPlayers;
+    h.adjIndexMode = (uint32_t)b->adjIndexMode;
+    h.adjWords = (uint32_t)b->adjWords;
+    h.adjHashMask = b->adjHashMask;
+    h.nRegions = (uint32_t)b->nRegions;
+    h.flags = b->adjInList == b->adjList ? MAPA_SIMETRICO : 0;
+    h.maxDegree = (uint32_t)b->maxDegree;
+
+    // nomes dos territórios seguidos dos nomes das regiões
+    uint32_t nNames = n + h.nRegions;
+    uint32_t *nameOffset = alocar(sizeof(uint32_t) * (nNames ? nNames : 1), "malloc nameOffset");
+    uint64_t sizeNames = 0;
+    for (uint32_t i = 0; i < nNames; ++i) {
+        nameOffset[i] = (uint32_t)sizeNames;
+        sizeNames += strlen(i < n ? nomeTerritorio(b->territories[i]) : textoString(b->regionNames[i - n])) + 1;
+    }
+    h.offNames = alinharMapa(sizeof(h));
+    h.sizeNames = sizeNames;
+    h.offNameOffsets = alinharMapa(h.offNames + sizeNames);
+    h.offOwner = alinharMapa(h.offNameOffsets + sizeof(uint32_t) * n);
+    h.offArmies = alinharMapa(h.offOwner + sizeof(int32_t) * n);
+    h.offRegion = alinharMapa(h.offArmies + sizeof(int32_t) * n);
+    h.offRegionNames = alinharMapa(h.offRegion + sizeof(int32_t) * n);
+    h.offRegionBonus = alinharMapa(h.offRegionNames + sizeof(uint32_t) * h.nRegions);
+    h.offAdjOffsets = alinharMapa(h.offRegionBonus + sizeof(int32_t) * h.nRegions);
+    h.offAdjList = alinharMapa(h.offAdjOffsets + sizeof(int32_t) * (n + 1));
+    h.offAdjIndex = alinharMapa(h.offAdjList + sizeof(int32_t) * h.nEdges);
+    const void *index = b->adjIndexMode == ADJ_INDICE_BITSET ? (const void *)b->adjBits : (const void *)b->adjHash;
+    h.sizeAdjIndex = b->adjIndexMode == ADJ_INDICE_BITSET
+                         ? sizeof(uint64_t) * (uint64_t)n * (uint64_t)b->adjWords
+                         : sizeof(uint64_t) * (b->adjHashMask + 1);
+    h.fileSize = h.offAdjIndex + h.sizeAdjIndex;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        free(nameOffset);
+        return 0;
+    }
+    uint64_t pos = 0;
+    int ok = gravarSecao(f, &pos, 0, &h, sizeof(h)) && gravarSecao(f, &pos, h.offNames, NULL, 0);
+    for (uint32_t i = 0; ok && i < nNames; ++i) {
+        const char *name = i < n ? nomeTerritorio(b->territories[i]) : textoString(b->regionNames[i - n]);
+        ok = gravarSecao(f, &pos, pos, name, strlen(name) + 1);
+    }
+    ok = ok && gravarSecao(f, &pos, h.offNameOffsets, nameOffset, sizeof(uint32_t) * n)
+            && gravarSecao(f, &pos, h.offOwner, b->owner, sizeof(int32_t) * n)
+            && gravarSecao(f, &pos, h.offArmies, b->armies, sizeof(int32_t) * n)
+            && gravarSecao(f, &pos, h.offRegion, b->region, sizeof(int32_t) * n)
+            && gravarSecao(f, &pos, h.offRegionNames, nameOffset + n, sizeof(uint32_t) * h.nRegions)
+            && gravarSecao(f, &pos, h.offRegionBonus, b->regionBonus, sizeof(int32_t) * h.nRegions)
+            && gravarSecao(f, &pos, h.offAdjOffsets, b->adjOffsets, sizeof(int32_t) * (n + 1))
+            && gravarSecao(f, &pos, h.offAdjList, b->adjList, sizeof(int32_t) * h.nEdges)
+            && gravarSecao(f, &pos, h.offAdjIndex, index, (size_t)h.sizeAdjIndex);
+    free(nameOffset);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) perror(path);
+    return ok;
+}
+
+/* Confere se [off, off + size) cabe no arquivo */
+static int secaoValida(uint64_t off, uint64_t size, size_t fileSize) {
+    return off <= fileSize && size <= fileSize - off && off % sizeof(uint32_t) == 0;
+}
+
+/* Confere o conteúdo que vira índice de array: donos em [0, nPlayers] (com
+ * nPlayers o maior dono, como em finalizarMapa), CSR monótono terminando em
+ * nEdges com vizinhos em [0, n), grau máximo coerente com o cabeçalho e
+ * índice de adjacência do tamanho certo. Uma passada O(n + E). */
+static int conteudoMapaValido(const MapFileHeader *h, const unsigned char *base) {
+    uint32_t n = h->nTerritories;
+    const int32_t *owner = (const int32_t *)(base + h->offOwner);
+    const int32_t *offsets = (const int32_t *)(base + h->offAdjOffsets);
+    const int32_t *list = (const int32_t *)(base + h->offAdjList);
+    int32_t maxOwner = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (owner[i] < 0 || (uint32_t)owner[i] > h->nPlayers) return 0;
+        if (owner[i] > maxOwner) maxOwner = owner[i];
+    }
+    if ((uint32_t)maxOwner != h->nPlayers) return 0;
+    if (offsets[0] != 0 || offsets[n] != (int32_t)h->nEdges || h->nEdges > INT32_MAX) return 0;
+    uint32_t maxOut = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (offsets[i + 1] < offsets[i]) return 0;
+        uint32_t deg = (uint32_t)(offsets[i + 1] - offsets[i]);
+        if (deg > maxOut) maxOut = deg;
+    }
+    for (uint32_t e = 0; e < h->nEdges; ++e)
+        if (list[e] < 0 || (uint32_t)list[e] >= n) return 0;
+    // simétrico: entrada = saída, então o grau total é o dobro da saída
+    if ((h->flags & MAPA_SIMETRICO) && h->maxDegree != 2 * maxOut) return 0;
+    if (h->adjIndexMode == ADJ_INDICE_BITSET) return h->adjWords == (n + 63) / 64;
+    // hash: potência de 2 com espaço para fator de carga <= 1/2 (o conteúdo é
+    // conferido por indiceAdjacenciaValido)
+    uint64_t cap = h->adjHashMask + 1;
+    return cap >= 16 && (cap & h->adjHashMask) == 0 && cap >= 2 * (uint64_t)h->nEdges;
+}
+
+/* Confere o índice de adjacência do arquivo contra o CSR já validado: cada
+ * aresta está no índice (achada pela mesma sondagem de saoVizinhos) e o
+ * índice não tem nada além delas. Em mapas marcados como simétricos,
+ * confere também que cada aresta u -> v tem a volta v -> u, já que o CSR
+ * reverso passa a ser o próprio CSR. O(n + E), com 'mark' de n posições. */
+static int indiceAdjacenciaValido(const Board *b, int simetrico) {
+    int n = b->nTerritories;
+    int *mark = alocar(sizeof(int) * (n ? n : 1), "malloc map check");
+    memset(mark, 0, sizeof(int) * (n ? n : 1));
+    uint64_t distinct = 0;
+    int ok = 1;
+    for (int i = 0; ok && i < n; ++i) {
+        uint64_t rowDistinct = 0;
+        if (b->adjIndexMode == ADJ_INDICE_HASH && i + MAPA_PREFETCH_LINHAS < n) {
+            // as sondagens caem em posições aleatórias da tabela: adianta as de linhas à frente
+            int ahead = i + MAPA_PREFETCH_LINHAS;
+            for (int e = b->adjOffsets[ahead]; e < b->adjOffsets[ahead + 1]; ++e)
+                __builtin_prefetch(&b->adjHash[slotAresta(chaveAresta(ahead, b->adjList[e]), b->adjHashMask)]);
+        }
+        for (int e = b->adjOffsets[i]; ok && e < b->adjOffsets[i + 1]; ++e) {
+            int v = b->adjList[e];
+            if (mark[v] != i + 1) {
+                mark[v] = i + 1;
+                rowDistinct++;
+            }
+            if (b->adjIndexMode == ADJ_INDICE_BITSET) {
+                ok = (int)((b->adjBits[(size_t)i * b->adjWords + (v >> 6)] >> (v & 63)) & 1);
+            } else {
+                uint64_t key = chaveAresta(i, v), s = slotAresta(key, b->adjHashMask), k = 0;
+                while (k++ <= b->adjHashMask && b->adjHash[s] && b->adjHash[s] != key) s = (s + 1) & b->adjHashMask;
+                ok = b->adjHash[s] == key;
+            }
+        }
+        if (ok && b->adjIndexMode == ADJ_INDICE_BITSET) {
+            // bits além das arestas da linha (inclusive depois da coluna n)
+            uint64_t bits = 0;
+            const uint64_t *row = b->adjBits + (size_t)i * b->adjWords;
+            for (int w = 0; w < b->adjWords; ++w) bits += (uint64_t)__builtin_popcountll(row[w]);
+            ok = bits == rowDistinct;
+        }
+        distinct += rowDistinct;
+    }
+    if (ok && b->adjIndexMode == ADJ_INDICE_HASH) {
+        // todas as chaves do CSR estão na tabela; ocupação igual implica nenhuma a mais
+        uint64_t used = 0;
+        for (uint64_t s = 0; s <= b->adjHashMask; ++s) used += b->adjHash[s] != 0;
+        ok = used == distinct;
+    }
+    free(mark);
+    // índice conferido: saoVizinhos agora responde exatamente pelo CSR
+    for (int i = 0; ok && simetrico && i < n; ++i)
+        for (int e = b->adjOffsets[i]; ok && e < b->adjOffsets[i + 1]; ++e)
+            ok = saoVizinhos(b, b->adjList[e], i);
+    return ok;
+}
+
+/* Mapeia um arquivo gerado por salvarMapaBinario e monta o tabuleiro sobre
+ * ele, já finalizado. O cabeçalho, os limites das seções e os valores
+ * usados como índice (donos, CSR, índice de adjacência) são conferidos.
+ * Retorna 1 em sucesso. */
+int carregarMapaBinario(Board *b, const char *path) {
+    inicializarTabuleiro(b);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MapFileHeader)) {
+        fprintf(stderr, "%s: arquivo de mapa inválido\n", path);
+        close(fd);
+        return 0;
+    }
+    size_t size = (size_t)st.st_size;
+    unsigned char *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return 0;
+    }
+
+    const MapFileHeader *h = (const MapFileHeader *)base;
+    uint64_t n = h->nTerritories;
+    int ok = memcmp(h->magic, MAPA_MAGIC, sizeof(h->magic)) == 0 && h->version == MAPA_VERSAO &&
+             h->byteOrder == 0x01020304 && h->fileSize == size && n < INT32_MAX &&
+             (h->adjIndexMode == ADJ_INDICE_BITSET || h->adjIndexMode == ADJ_INDICE_HASH) &&
+             secaoValida(h->offNames, h->sizeNames, size) &&
+             secaoValida(h->offNameOffsets, 4 * n, size) &&
+             secaoValida(h->offOwner, 4 * n, size) &&
+             secaoValida(h->offArmies, 4 * n, size) &&
+             secaoValida(h->offRegion, 4 * n, size) &&
+             secaoValida(h->offRegionNames, 4 * (uint64_t)h->nRegions, size) && h->nRegions < INT32_MAX &&
+             secaoValida(h->offRegionBonus, 4 * (uint64_t)h->nRegions, size) &&
+             secaoValida(h->offAdjOffsets, 4 * (n + 1), size) &&
+             secaoValida(h->offAdjList, 4 * (uint64_t)h->nEdges, size) &&
+             secaoValida(h->offAdjIndex, h->sizeAdjIndex, size) &&
+             h->sizeAdjIndex == (h->adjIndexMode == ADJ_INDICE_BITSET
+                                     ? 8 * n * h->adjWords : 8 * (h->adjHashMask + 1)) &&
+             h->sizeNames > 0 && base[h->offNames + h->sizeNames - 1] == '\0' &&
+             ((const int32_t *)(base + h->offAdjOffsets))[n] == (int32_t)h->nEdges &&
+             conteudoMapaValido(h, base);
+    if (!ok) {
+        fprintf(stderr, "%s: arquivo de mapa inválido ou de outra versão\n", path);
+        munmap(base, size);
+        return 0;
+    }
+
+    // visões Territory: um único bloco na arena; os nomes são internados (um
+    // mapa carregado de novo só consulta a tabela, sem copiar nada)
+    const uint32_t *nameOffset = (const uint32_t *)(base + h->offNameOffsets);
+    for (uint64_t i = 0; i < n; ++i) {
+        if (nameOffset[i] >= h->sizeNames) {
+            fprintf(stderr, "%s: nome de território fora da tabela\n", path);
+            munmap(base, size);
+            return 0;
+        }
+    }
+    Territory *views = arenaAlloc(&b->arena, sizeof(Territory) * (n ? n : 1));
+    b->territories = alocar(sizeof(Territory *) * (n ? n : 1), "malloc territories");
+    uint32_t *nameIds = alocar(sizeof(uint32_t) * (n ? n : 1), "malloc territories");
+    internarStringsEmLote((const char *)base + h->offNames, nameOffset, (uint32_t)n, nameIds);
+    for (uint64_t i = 0; i < n; ++i) {
+        views[i].nameId = nameIds[i];
+        views[i].id = (int)i;
+        b->territories[i] = &views[i];
+    }
+    free(nameIds);
+
+    const uint32_t *regionNameOffset = (const uint32_t *)(base + h->offRegionNames);
+    b->regionNames = arenaAlloc(&b->arena, sizeof(uint32_t) * (h->nRegions ? h->nRegions : 1));
+    for (uint32_t r = 0; r < h->nRegions; ++r) {
+        if (regionNameOffset[r] >= h->sizeNames) {
+            fprintf(stderr, "%s: nome de região fora da tabela\n", path);
+            free(b->territories);
+            b->territories = NULL;
+            munmap(base, size);
+            return 0;
+        }
+        b->regionNames[r] = internarString((const char *)base + h->offNames + regionNameOffset[r]);
+    }
+
+    // faixas das regiões: o arquivo precisa ter os ids agrupados por região
+    const int32_t *region = (const int32_t *)(base + h->offRegion);
+    int R = (int)h->nRegions;
+    b->regionStart = arenaAlloc(&b->arena, sizeof(int) * (R + 2));
+    memset(b->regionStart, 0, sizeof(int) * (R + 2));
+    int prev = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        int key = region[i] < 0 ? R : region[i];
+        if (region[i] < -1 || region[i] >= R || key < prev) {
+            fprintf(stderr, "%s: regiões inválidas ou fora de ordem\n", path);
+            free(b->territories);
+            b->territories = NULL;
+            munmap(base, size);
+            return 0;
+        }
+        prev = key;
+        b->regionStart[key + 1]++;
+    }
+    for (int r = 0; r <= R; ++r) b->regionStart[r + 1] += b->regionStart[r];
+
+    b->nTerritories = b->capTerritories = (int)n;
+    b->nPlayers = (int)h->nPlayers;
+    b->nRegions = b->capRegions = (int)h->nRegions;
+    b->regionBonus = (int *)(base + h->offRegionBonus);
+    b->owner = (int *)(base + h->offOwner);
+    b->armies = (int *)(base + h->offArmies);
+    b->region = (int *)(base + h->offRegion);
+    b->adjOffsets = (int *)(base + h->offAdjOffsets);
+    b->adjList = (int *)(base + h->offAdjList);
+    b->adjIndexMode = (int)h->adjIndexMode;
+    b->adjWords = (int)h->adjWords;
+    b->adjHashMask = h->adjHashMask;
+    if (b->adjIndexMode == ADJ_INDICE_BITSET) b->adjBits = (uint64_t *)(base + h->offAdjIndex);
+    else b->adjHash = (uint64_t *)(base + h->offAdjIndex);
+    if (!indiceAdjacenciaValido(b, (h->flags & MAPA_SIMETRICO) != 0)) {
+        fprintf(stderr, "%s: índice de adjacência ou simetria não confere com o CSR\n", path);
+        free(b->territories);
+        b->territories = NULL;
+        munmap(base, size);
+        return 0;
+    }
+    b->mapBase = base;
+    b->mapSize = size;
+    b->finalized = 1;
+    recalcularHash(b);
+    if (h->flags & MAPA_SIMETRICO) {
+        b->adjInOffsets = b->adjOffsets;
+        b->adjInList = b->adjList;
+        b->maxDegree = (int)h->maxDegree;
+    } else {
+        construirAdjacenciaReversa(b);
+    }
+    alocarContadores(b);
+    recalcularContadores(b);
+    recalcularFronteiras(b, 0);
+    recalcularComponentes(b);
+    return 1;
+}
 
-/* Estrutura que representa um território no jogo */
-typedef struct Territory {
-    char *name;                 // nome alocado dinamicamente
-    int owner;                  // id do jogador dono (0 = neutro / 1..n = jogadores)
-    int armies;                 // número de exércitos no território
-    int nNeighbors;             // número de vizinhos
-    struct Territory **neighbors; // array de ponteiros para territórios vizinhos
-} Territory;
+/* ------------------------------------------------------------------------
+ * Reprodução de replay
+ * ------------------------------------------------------------------------ */
 
-/* Estrutura que representa uma missão estratégica */
-typedef struct Mission {
-    char *description; // descrição alocada dinamicamente
-    int targetOwner;   // exemplo: missão relacionada a um dono específico
-} Mission;
+/* Reaplica em 'b' (o mesmo mapa, no estado inicial da gravação) os eventos
+ * do arquivo de replay, direto da memória mapeada e sem RNG. Confere o hash
+ * inicial, a consistência de cada evento e o hash final. Retorna 1 em caso
+ * de sucesso; 'events' recebe quantos eventos foram aplicados. */
+int reproduzirReplay(Board *b, const char *path, long *events) {
+    *events = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ReplayHeader)) {
+        fprintf(stderr, "%s: arquivo de replay inválido\n", path);
+        close(fd);
+        return 0;
+    }
+    size_t size = (size_t)st.st_size;
+    unsigned char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return 0;
+    }
 
-/* Cria e retorna um território com nome e dono fornecidos */
-Territory *criarTerritorio(const char *name, int owner, int armies) {
-    Territory *t = malloc(sizeof(Territory));
-    if (!t) {
-        perror("malloc Territory");
-        exit(EXIT_FAILURE);
+    // um replay fechado tem exatamente 'events' registros; um interrompido
+    // pode ter um lote a mais (ou um registro pela metade) depois deles
+    const ReplayHeader *h = (const ReplayHeader *)base;
+    uint64_t stored = (size - sizeof(ReplayHeader)) / sizeof(ReplayRecord);
+    int closed = (h->flags & REPLAY_FECHADO) != 0;
+    int ok = memcmp(h->magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) == 0 && h->version == REPLAY_VERSAO &&
+             h->events <= stored &&
+             (!closed || (stored == h->events && (size - sizeof(ReplayHeader)) % sizeof(ReplayRecord) == 0));
+    if (!ok) {
+        fprintf(stderr, "%s: arquivo de replay inválido ou de outra versão\n", path);
+    } else if (h->nTerritories != (uint32_t)b->nTerritories || h->initialHash != b->hash) {
+        fprintf(stderr, "%s: replay gravado sobre outro mapa ou estado inicial\n", path);
+        ok = 0;
     }
-    t->name = malloc(strlen(name) + 1);
-    if (!t->name) {
-        perror("malloc name");
-        free(t);
-        exit(EXIT_FAILURE);
+
+    const ReplayRecord *r = (const ReplayRecord *)(base + sizeof(ReplayHeader));
+    int n = b->nTerritories;
+    for (uint64_t k = 0; ok && k < h->events; ++k, ++r) {
+        int from = r->from, to = r->to;
+        if (to < 0 || to >= n || (r->kind == REPLAY_COMBATE && (from < 0 || from >= n)) ||
+            (r->kind != REPLAY_COMBATE && r->kind != REPLAY_REFORCO) || r->fromArmies < 0 || r->toArmies < 0) {
+            fprintf(stderr, "%s: evento %llu inválido\n", path, (unsigned long long)k);
+            ok = 0;
+            break;
+        }
+        if (r->kind == REPLAY_COMBATE) {
+            if (r->conquered) definirDono(b, to, b->owner[from]);
+            definirExercitos(b, from, r->fromArmies);
+        }
+        definirExercitos(b, to, r->toArmies);
+        ++*events;
     }
-    strcpy(t->name, name);
-    t->owner = owner;
-    t->armies = armies;
-    t->nNeighbors = 0;
-    t->neighbors = NULL;
-    return t;
+    if (ok && !closed) {
+        fprintf(stderr, "%s: gravação interrompida; reproduzidos os %llu eventos completos, sem conferir o estado final\n",
+                path, (unsigned long long)h->events);
+    } else if (ok && b->hash != h->finalHash) {
+        fprintf(stderr, "%s: estado final diverge da gravação\n", path);
+        ok = 0;
+    }
+    munmap(base, size);
+    return ok;
 }
 
-/* Adiciona um vizinho a um território (cresce dinamicamente o array) */
-void adicionarVizinho(Territory *t, Territory *vizinho) {
-    t->neighbors = realloc(t->neighbors, sizeof(Territory *) * (t->nNeighbors + 1));
-    if (!t->neighbors) {
-        perror("realloc neighbors");
-        exit(EXIT_FAILURE);
+/* Lê do cabeçalho do replay a origem do mapa gravado. Retorna 1 em sucesso. */
+int lerMapaReplay(const char *path, ReplayMapInfo *map) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 0;
     }
-    t->neighbors[t->nNeighbors++] = vizinho;
+    ReplayHeader h;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) == 0 &&
+             h.version == REPLAY_VERSAO;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "%s: arquivo de replay inválido ou de outra versão\n", path);
+        return 0;
+    }
+    *map = h.map;
+    return 1;
 }
 
-/* Cria e retorna uma missão */
-Mission *criarMissao(const char *desc, int targetOwner) {
-    Mission *m = malloc(sizeof(Mission));
-    if (!m) {
-        perror("malloc Mission");
-        exit(EXIT_FAILURE);
+/* ------------------------------------------------------------------------
+ * Simulação Monte Carlo de partidas completas
+ *
+ * Um tabuleiro modelo (montado com criarTerritorio/adicionarVizinho e
+ * finalizado) é clonado uma vez por thread. Cada thread joga partidas
+ * aleatórias independentes no seu clone, reiniciando dono/exércitos a partir
+ * do modelo, com RNG e arena próprios. A divisão do trabalho usa roubo de
+ * tarefas sem locks: cada thread consome lotes da sua faixa de partidas com
+ * um fetch_add atômico e, quando ela acaba, rouba lotes das faixas das
+ * outras pelo mesmo contador. As estatísticas ficam em memória da própria
+ * thread e só são somadas depois do join.
+ * ------------------------------------------------------------------------ */
+
+#define SIM_LOTE 16 // partidas reivindicadas por fetch_add
+
+/* Parâmetros da simulação */
+typedef struct SimConfig {
+    long nGames;         // número de partidas
+    int nThreads;        // 0 = número de CPUs
+    int maxTurns;        // limite de turnos por partida
+    int attacksPerTurn;  // ataques (batalhas completas) por turno
+    int reinforce;       // 1 = fase de reforço no início de cada turno
+    uint64_t seed;       // semente base; a partida g usa uma semente derivada de (seed, g)
+} SimConfig;
+
+/* Estatísticas agregadas */
+typedef struct SimStats {
+    long games;
+    long turns;          // soma dos turnos jogados
+    long draws;          // partidas sem vencedor único
+    long *wins;          // vitórias por jogador (nPlayers + 1 posições; 0 não é usado)
+    int nPlayers;
+} SimStats;
+
+/* Estado de cada thread (alinhado para que contadores não dividam linha de cache) */
+typedef struct SimWorker {
+    _Alignas(64) atomic_long next;  // próxima partida da faixa desta thread
+    long end;                       // fim (exclusivo) da faixa
+    struct SimWorker *all;          // todas as threads (para roubo)
+    int index;
+    int count;
+    const Board *model;
+    const SimConfig *cfg;
+    Board board;                    // clone com topologia compartilhada
+    Attack *moves;                  // buffer de gerarAtaques (na arena do clone)
+    int *scratch;                   // buffer de ids para o reforço
+    long games, turns, draws;
+    long *wins;
+    pthread_t thread;
+} SimWorker;
+
+/* Joga o turno aleatório do jogador 'p' (nada, se ele foi eliminado) e
+ * retorna 1 se ele atacou. Buffers como em simularPartida. */
+static int jogarTurno(Board *b, Rng *rng, const SimConfig *cfg, int p, Attack *moves, int *scratch) {
+    if (jogadorEliminado(b, p)) return 0;
+    if (cfg->reinforce) reforcarJogador(b, rng, p, scratch);
+    int nEdges = b->adjOffsets[b->nTerritories], attacked = 0;
+    for (int k = 0; k < cfg->attacksPerTurn; ++k) {
+        int nMoves = gerarAtaques(b, p, moves, nEdges);
+        if (nMoves == 0) break;
+        const Attack *m = &moves[rngIntervalo(rng, (uint32_t)nMoves)];
+        resolverBatalha(b, rng, b->territories[m->from], b->territories[m->to], NULL);
+        attacked = 1;
     }
-    m->description = malloc(strlen(desc) + 1);
-    if (!m->description) {
-        perror("malloc desc");
-        free(m);
-        exit(EXIT_FAILURE);
+    return attacked;
+}
+
+/* Joga uma partida aleatória sobre o estado atual do tabuleiro: cada turno
+ * começa com o reforço do jogador (se cfg->reinforce) e, a cada ataque, ele
+ * escolhe um ataque uniforme da lista de gerarAtaques. 'moves' é um buffer
+ * de rascunho com uma posição por aresta do mapa e 'scratch', com uma por
+ * território.
+ * Retorna o vencedor (o jogador com mais territórios ao final; 0 em empate)
+ * e escreve em *turns quantos turnos foram jogados. */
+int simularPartida(Board *b, Rng *rng, const SimConfig *cfg, Attack *moves, int *scratch, int *turns) {
+    int idle = 0, turn = 0;
+    for (; turn < cfg->maxTurns && idle < b->nPlayers; ++turn) {
+        int p = turn % b->nPlayers + 1;
+        int attacked = jogarTurno(b, rng, cfg, p, moves, scratch);
+        idle = attacked ? 0 : idle + 1;
+        if (attacked && b->ownerCount[p] == b->nTerritories) { ++turn; break; }
     }
-    strcpy(m->description, desc);
-    m->targetOwner = targetOwner;
-    return m;
+    *turns = turn;
+
+    int winner = 0, best = -1;
+    for (int p = 1; p <= b->nPlayers; ++p) {
+        int c = b->ownerCount[p]; // mantido por definirDono, O(1)
+        if (c > best) { best = c; winner = p; }
+        else if (c == best) winner = 0;
+    }
+    return winner;
 }
 
-/* Valida se um ataque é permitido:
- * - jogador só pode atacar territórios que NÃO são dele
- * - o território atacante deve ter pelo menos 2 exércitos (ex.: 1 fica para defesa)
- */
-int validarAtaque(Territory *from, Territory *to, int playerId) {
-    if (!from || !to) return 0;
-    if (from->owner != playerId) {
-        // só pode atacar se for dono do território atacante
-        return 0;
+/* Reivindica um lote de partidas da faixa de 'w'; retorna o início ou -1 */
+static long reivindicarLote(SimWorker *w, long *end) {
+    long start = atomic_fetch_add_explicit(&w->next, SIM_LOTE, memory_order_relaxed);
+    if (start >= w->end) return -1;
+    *end = start + SIM_LOTE < w->end ? start + SIM_LOTE : w->end;
+    return start;
+}
+
+static void *threadSimulacao(void *arg) {
+    SimWorker *w = arg;
+    const SimConfig *cfg = w->cfg;
+    Rng rng;
+    for (int v = 0; v < w->count; ++v) {
+        // primeiro a própria faixa, depois as das outras threads, em ordem
+        SimWorker *victim = &w->all[(w->index + v) % w->count];
+        long start, end;
+        while ((start = reivindicarLote(victim, &end)) >= 0) {
+            for (long g = start; g < end; ++g) {
+                copiarEstado(&w->board, w->model);
+                rngSemear(&rng, cfg->seed ^ (0x9E3779B97F4A7C15ull * (uint64_t)(g + 1)));
+                int turns;
+                int winner = simularPartida(&w->board, &rng, cfg, w->moves, w->scratch, &turns);
+                w->games++;
+                w->turns += turns;
+                if (winner) w->wins[winner]++; else w->draws++;
+            }
+        }
     }
-    if (to->owner == playerId) {
-        // não pode atacar um próprio território
-        return 0;
+    return NULL;
+}
+
+/* Joga cfg->nGames partidas a partir do tabuleiro modelo (finalizado) em
+ * várias threads e soma as estatísticas em 'stats' (liberar com
+ * liberarEstatisticas). */
+void simularPartidas(const Board *model, const SimConfig *cfg, SimStats *stats) {
+    int nThreads = cfg->nThreads > 0 ? cfg->nThreads : numeroDeNucleos();
+
+    SimWorker *workers = alocar(sizeof(SimWorker) * nThreads, "malloc workers");
+    for (int i = 0; i < nThreads; ++i) {
+        SimWorker *w = &workers[i];
+        memset(w, 0, sizeof(*w));
+        long lo = cfg->nGames * i / nThreads, hi = cfg->nGames * (i + 1) / nThreads;
+        atomic_init(&w->next, lo);
+        w->end = hi;
+        w->all = workers;
+        w->index = i;
+        w->count = nThreads;
+        w->model = model;
+        w->cfg = cfg;
+        clonarTabuleiro(&w->board, model);
+        w->moves = arenaAlloc(&w->board.arena, sizeof(Attack) * (model->adjOffsets[model->nTerritories] + 1));
+        w->scratch = arenaAlloc(&w->board.arena, sizeof(int) * (model->nTerritories + 1));
+        w->wins = arenaAlloc(&w->board.arena, sizeof(long) * (model->nPlayers + 1));
+        memset(w->wins, 0, sizeof(long) * (model->nPlayers + 1));
     }
-    if (from->armies < 2) {
-        // precisa de ao menos 2 exércitos para realizar ataque (um fica defendendo)
-        return 0;
+    for (int i = 0; i < nThreads; ++i) {
+        if (pthread_create(&workers[i].thread, NULL, threadSimulacao, &workers[i]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
     }
-    // opcional: validar se 'to' é vizinho de 'from'
-    int found = 0;
-    for (int i = 0; i < from->nNeighbors; ++i) {
-        if (from->neighbors[i] == to) { found = 1; break; }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->nPlayers = model->nPlayers;
+    stats->wins = alocar(sizeof(long) * (model->nPlayers + 1), "malloc stats");
+    memset(stats->wins, 0, sizeof(long) * (model->nPlayers + 1));
+    for (int i = 0; i < nThreads; ++i) {
+        SimWorker *w = &workers[i];
+        pthread_join(w->thread, NULL);
+        stats->games += w->games;
+        stats->turns += w->turns;
+        stats->draws += w->draws;
+        for (int p = 0; p <= model->nPlayers; ++p) stats->wins[p] += w->wins[p];
+        liberarMemoria(&w->board);
+        arenaDestroy(&w->board.arena);
     }
-    if (!found) return 0;
-    return 1; // ataque válido
+    free(workers);
 }
 
-/* Exemplo simples de resolução de combate (aleatório) */
-void resolverAtaque(Territory *from, Territory *to) {
-    // números aleatórios para exemplo (usar srand(time(NULL)) no main)
-    int attackRoll = rand() % 6 + 1; // 1..6
-    int defendRoll = rand() % 6 + 1; // 1..6
+void liberarEstatisticas(SimStats *stats) {
+    free(stats->wins);
+    stats->wins = NULL;
+}
 
-    printf("Rolagem atacante: %d | defensor: %d\n", attackRoll, defendRoll);
-    if (attackRoll > defendRoll) {
-        // atacante vence: reduz defender, possivelmente conquista
-        to->armies -= 1;
-        if (to->armies <= 0) {
-            printf("Território %s conquistado!\n", to->name);
-            to->owner = from->owner;
-            // mover pelo menos 1 exército do atacante para o território conquistado
-            from->armies -= 1;
-            to->armies = 1;
+/* ------------------------------------------------------------------------
+ * Servidor de partidas
+ *
+ * Muitas partidas independentes no mesmo processo. Cada Match é dono do
+ * seu estado: um clone do tabuleiro modelo (com arena própria, onde ficam
+ * também as missões e os buffers), o RNG e o andamento. O servidor tem um
+ * número fixo de threads, e cada partida pertence a um único shard (id %
+ * threads) durante toda a vida: a thread do shard alterna entre as suas
+ * partidas ativas, SERVIDOR_FATIA turnos de cada vez, sem compartilhar
+ * nada com as outras. O único ponto de contato é a fila de entrada de cada
+ * shard, protegida por um mutex que só é tocado ao submeter partidas.
+ * ------------------------------------------------------------------------ */
+
+#define SERVIDOR_FATIA 4 // turnos por partida a cada volta do shard
+#define SERVIDOR_ADIAR_MIN 65536 // territórios a partir dos quais a liberação vai para o fundo
+
+/* Uma partida hospedada pelo servidor */
+typedef struct Match {
+    Board board;            // clone do modelo (arena própria)
+    Rng rng;
+    Mission **missions;     // missão de cada jogador [1..nPlayers] (na arena)
+    Attack *moves;          // buffers de jogarTurno (na arena)
+    int *scratch;
+    int turn, idle;
+    int finished;
+    int winner;             // 0 = empate
+    int byMission;          // 1 = vencida por missão cumprida
+    uint64_t id;
+    struct Match *next;     // fila de entrada do shard
+} Match;
+
+/* Prepara a partida 'id' sobre o modelo finalizado: jogadores ímpares têm
+ * de eliminar o próximo jogador, os pares de conquistar 2/3 do mapa */
+void criarPartida(Match *m, const Board *model, uint64_t id, uint64_t seed) {
+    memset(m, 0, sizeof(*m));
+    m->id = id;
+    clonarTabuleiro(&m->board, model);
+    Board *b = &m->board;
+    rngSemear(&m->rng, seed);
+    b->sink = NULL;
+    m->moves = arenaAlloc(&b->arena, sizeof(Attack) * (b->adjOffsets[b->nTerritories] + 1));
+    m->scratch = arenaAlloc(&b->arena, sizeof(int) * (b->nTerritories + 1));
+    m->missions = arenaAlloc(&b->arena, sizeof(Mission *) * (b->nPlayers + 1));
+    m->missions[0] = NULL;
+    char desc[64];
+    for (int p = 1; p <= b->nPlayers; ++p) {
+        if (p % 2 && b->nPlayers > 1) {
+            int target = p % b->nPlayers + 1;
+            snprintf(desc, sizeof(desc), "Eliminar jogador %d", target);
+            m->missions[p] = criarMissao(b, desc, MISSAO_ELIMINAR, target, -1, 0);
         } else {
-            printf("%s perde 1 exército (restam %d)\n", to->name, to->armies);
+            int count = (2 * b->nTerritories + 2) / 3;
+            snprintf(desc, sizeof(desc), "Conquistar %d territórios", count);
+            m->missions[p] = criarMissao(b, desc, MISSAO_CONQUISTAR, 0, -1, count);
         }
-    } else {
-        // defensor vence
-        from->armies -= 1;
-        printf("%s perde 1 exército (restam %d)\n", from->name, from->armies);
     }
 }
 
-/* Função pedida: libera toda a memória alocada para territórios e missões.
- *
- * territories: array de ponteiros para Territory (size = nTerritories)
- * missions: array de ponteiros para Mission (size = nMissions)
+/* Joga até 'turns' turnos. A partida termina quando o jogador da vez
+ * cumpre a missão, ninguém mais consegue atacar ou cfg->maxTurns chega
+ * (vence quem tem mais territórios). Retorna 1 se terminou. */
+int avancarPartida(Match *m, const SimConfig *cfg, int turns) {
+    Board *b = &m->board;
+    for (int t = 0; t < turns && !m->finished; ++t, ++m->turn) {
+        if (m->turn >= cfg->maxTurns || m->idle >= b->nPlayers) {
+            m->finished = 1;
+            int best = -1;
+            for (int p = 1; p <= b->nPlayers; ++p) {
+                if (b->ownerCount[p] > best) { best = b->ownerCount[p]; m->winner = p; }
+                else if (b->ownerCount[p] == best) m->winner = 0;
+            }
+            break;
+        }
+        int p = m->turn % b->nPlayers + 1;
+        int attacked = jogarTurno(b, &m->rng, cfg, p, m->moves, m->scratch);
+        m->idle = attacked ? 0 : m->idle + 1;
+        if (attacked && missaoCumprida(b, m->missions[p], p)) {
+            m->finished = 1;
+            m->winner = p;
+            m->byMission = 1;
+        }
+    }
+    return m->finished;
+}
+
+/* Libera a partida; partidas gigantes são liberadas em segundo plano para
+ * não parar as outras partidas do shard */
+void liberarPartida(Match *m) {
+    if (m->board.nTerritories >= SERVIDOR_ADIAR_MIN) liberarMemoriaAdiada(&m->board);
+    else liberarMemoria(&m->board);
+    arenaDestroy(&m->board.arena);
+}
+
+/* Um shard: uma thread e as partidas dela */
+typedef struct MatchShard {
+    pthread_mutex_t lock;   // protege inbox e closing
+    pthread_cond_t wake;
+    Match *inbox;           // partidas submetidas ainda não adotadas
+    int closing;
+    Match **active;         // partidas da thread (só ela acessa)
+    int nActive, capActive;
+    int peak;               // maior número de partidas ativas ao mesmo tempo
+    long games, turns, draws, byMission;
+    long *wins;
+    const struct MatchServer *server;
+    pthread_t thread;
+    char pad[64];           // shards vizinhos não dividem linha de cache
+} MatchShard;
+
+typedef struct MatchServer {
+    const Board *model;
+    SimConfig cfg;
+    int nShards;
+    MatchShard *shards;
+    atomic_ulong nextId;
+} MatchServer;
+
+static void *threadShard(void *arg) {
+    MatchShard *s = arg;
+    const SimConfig *cfg = &s->server->cfg;
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        while (!s->inbox && !s->nActive && !s->closing) pthread_cond_wait(&s->wake, &s->lock);
+        Match *in = s->inbox;
+        s->inbox = NULL;
+        int closing = s->closing;
+        pthread_mutex_unlock(&s->lock);
+
+        for (; in; in = in->next) {
+            if (s->nActive == s->capActive) {
+                s->capActive = s->capActive ? s->capActive * 2 : 64;
+                s->active = realocar(s->active, sizeof(Match *) * s->capActive, "realloc shard");
+            }
+            s->active[s->nActive++] = in;
+        }
+        if (s->nActive > s->peak) s->peak = s->nActive;
+        if (!s->nActive && closing) break;
+
+        // uma volta: uma fatia de cada partida ativa
+        for (int i = 0; i < s->nActive;) {
+            Match *m = s->active[i];
+            if (!avancarPartida(m, cfg, SERVIDOR_FATIA)) { ++i; continue; }
+            s->games++;
+            s->turns += m->turn;
+            s->byMission += m->byMission;
+            if (m->winner) s->wins[m->winner]++; else s->draws++;
+            liberarPartida(m);
+            free(m);
+            s->active[i] = s->active[--s->nActive];
+        }
+    }
+    free(s->active);
+    return NULL;
+}
+
+/* Inicia o servidor com cfg->nThreads shards (0 = número de CPUs) sobre o
+ * modelo finalizado, que precisa viver até encerrarServidor */
+void iniciarServidor(MatchServer *srv, const Board *model, const SimConfig *cfg) {
+    int n = cfg->nThreads > 0 ? cfg->nThreads : numeroDeNucleos();
+    srv->model = model;
+    srv->cfg = *cfg;
+    srv->nShards = n;
+    atomic_init(&srv->nextId, 0);
+    srv->shards = alocar(sizeof(MatchShard) * n, "malloc shards");
+    for (int i = 0; i < n; ++i) {
+        MatchShard *s = &srv->shards[i];
+        memset(s, 0, sizeof(*s));
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->wake, NULL);
+        s->wins = alocar(sizeof(long) * (model->nPlayers + 1), "malloc shards");
+        memset(s->wins, 0, sizeof(long) * (model->nPlayers + 1));
+        s->server = srv;
+        if (pthread_create(&s->thread, NULL, threadShard, s) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+/* Cria uma partida e a entrega ao shard dela; retorna o id da partida */
+uint64_t submeterPartida(MatchServer *srv, uint64_t seed) {
+    uint64_t id = atomic_fetch_add_explicit(&srv->nextId, 1, memory_order_relaxed);
+    Match *m = alocar(sizeof(Match), "malloc match");
+    criarPartida(m, srv->model, id, seed);
+    MatchShard *s = &srv->shards[id % (uint64_t)srv->nShards];
+    pthread_mutex_lock(&s->lock);
+    m->next = s->inbox;
+    s->inbox = m;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    return id;
+}
+
+/* Espera todas as partidas submetidas terminarem, encerra as threads e
+ * soma as estatísticas em 'stats' (liberar com liberarEstatisticas).
+ * 'peak' e 'byMission', se não forem NULL, recebem o máximo de partidas
+ * simultâneas e quantas foram vencidas por missão. */
+void encerrarServidor(MatchServer *srv, SimStats *stats, long *peak, long *byMission) {
+    int nPlayers = srv->model->nPlayers;
+    memset(stats, 0, sizeof(*stats));
+    stats->nPlayers = nPlayers;
+    stats->wins = alocar(sizeof(long) * (nPlayers + 1), "malloc stats");
+    memset(stats->wins, 0, sizeof(long) * (nPlayers + 1));
+    long maxActive = 0, missions = 0;
+    for (int i = 0; i < srv->nShards; ++i) {
+        MatchShard *s = &srv->shards[i];
+        pthread_mutex_lock(&s->lock);
+        s->closing = 1;
+        pthread_cond_signal(&s->wake);
+        pthread_mutex_unlock(&s->lock);
+    }
+    for (int i = 0; i < srv->nShards; ++i) {
+        MatchShard *s = &srv->shards[i];
+        pthread_join(s->thread, NULL);
+        stats->games += s->games;
+        stats->turns += s->turns;
+        stats->draws += s->draws;
+        for (int p = 0; p <= nPlayers; ++p) stats->wins[p] += s->wins[p];
+        maxActive += s->peak;
+        missions += s->byMission;
+        free(s->wins);
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->wake);
+    }
+    free(srv->shards);
+    srv->shards = NULL;
+    aguardarLiberacoes(); // clones adiados ainda leem o modelo
+    if (peak) *peak = maxActive;
+    if (byMission) *byMission = missions;
+}
+
+/* ------------------------------------------------------------------------
+ * Gerador de mapas sintéticos
  *
- * Importante: a função assume que todos os ponteiros são válidos ou NULL.
+ * Mapas grandes para testes de escala: grade (4 vizinhos, ou 8 com
+ * grau >= 8), hexágonos (6 vizinhos) ou "quase planar" aleatório (pontos
+ * no quadrado unitário ligados aos k mais próximos, com k sorteado por
+ * território em [grau - variação, grau + variação]). As regiões são blocos
+ * retangulares do plano e os donos são distribuídos ao acaso, em partes
+ * iguais. O resultado é um tabuleiro finalizado comum: pode ser simulado
+ * direto ou gravado com salvarMapaBinario.
+ * ------------------------------------------------------------------------ */
+
+typedef enum MapKind {
+    MAPA_GRADE = 0,
+    MAPA_HEX,
+    MAPA_ALEATORIO
+} MapKind;
+
+#define GERADOR_GRAU_MAX 32 // k máximo do mapa aleatório
+
+/* Parâmetros do gerador */
+typedef struct MapGenConfig {
+    MapKind kind;
+    int nTerritories;
+    int nPlayers;        // donos 1..nPlayers (0 = todos neutros)
+    int nRegions;        // blocos do plano (0 = sem regiões)
+    int degree;          // grau alvo do mapa aleatório (grade: 4 ou 8)
+    int degreeJitter;    // variação do grau por território (mapa aleatório)
+    int armies;          // exércitos iniciais de cada território
+    uint64_t seed;
+} MapGenConfig;
+
+/* Posição de um território no quadrado unitário */
+typedef struct GenPoint {
+    double x, y;
+} GenPoint;
+
+static int compararChaves(const void *a, const void *c) {
+    uint64_t ka = *(const uint64_t *)a, kc = *(const uint64_t *)c;
+    return (ka > kc) - (ka < kc);
+}
+
+/* Arestas não direcionadas (min << 32 | max): ordenadas e sem repetição */
+typedef struct GenEdges {
+    uint64_t *keys;
+    size_t n, cap;
+} GenEdges;
+
+static void ligarGerador(GenEdges *e, int a, int c) {
+    if (a == c) return;
+    if (a > c) { int t = a; a = c; c = t; }
+    if (e->n == e->cap) {
+        e->cap = e->cap ? e->cap * 2 : 1024;
+        e->keys = realocar(e->keys, sizeof(uint64_t) * e->cap, "realloc edges");
+    }
+    e->keys[e->n++] = (uint64_t)a << 32 | (uint32_t)c;
+}
+
+static void gerarGrade(GenEdges *e, GenPoint *pts, int n, int diagonais) {
+    int w = 1;
+    while ((long)w * w < n) ++w;
+    for (int i = 0; i < n; ++i) {
+        int x = i % w, y = i / w;
+        pts[i].x = (x + 0.5) / w;
+        pts[i].y = (y + 0.5) / w;
+        if (x + 1 < w && i + 1 < n) ligarGerador(e, i, i + 1);
+        if (i + w < n) ligarGerador(e, i, i + w);
+        if (diagonais && x + 1 < w && i + w + 1 < n) ligarGerador(e, i, i + w + 1);
+        if (diagonais && x > 0 && i + w - 1 < n) ligarGerador(e, i, i + w - 1);
+    }
+}
+
+/* Hexágonos em linhas deslocadas: linhas ímpares ficam meia célula à direita */
+static void gerarHex(GenEdges *e, GenPoint *pts, int n) {
+    int w = 1;
+    while ((long)w * w < n) ++w;
+    for (int i = 0; i < n; ++i) {
+        int x = i % w, y = i / w, odd = y & 1;
+        pts[i].x = (x + 0.5 + 0.5 * odd) / (w + 0.5);
+        pts[i].y = (y + 0.5) / w;
+        if (x + 1 < w && i + 1 < n) ligarGerador(e, i, i + 1);
+        // vizinhos da linha de baixo: (x - 1 + odd) e (x + odd)
+        int below = i + w;
+        if (odd) {
+            if (below < n) ligarGerador(e, i, below);
+            if (x + 1 < w && below + 1 < n) ligarGerador(e, i, below + 1);
+        } else {
+            if (x > 0 && below - 1 < n) ligarGerador(e, i, below - 1);
+            if (below < n) ligarGerador(e, i, below);
+        }
+    }
+}
+
+/* k vizinhos mais próximos com baldes espaciais (~2 pontos por célula):
+ * os anéis de células em volta do ponto são visitados em ordem até que o
+ * k-ésimo candidato esteja mais perto que qualquer ponto do próximo anel */
+static void gerarAleatorio(GenEdges *e, GenPoint *pts, int n, int degree, int jitter, Rng *rng) {
+    for (int i = 0; i < n; ++i) {
+        pts[i].x = (double)(rngProximo(rng) >> 11) * 0x1.0p-53;
+        pts[i].y = (double)(rngProximo(rng) >> 11) * 0x1.0p-53;
+    }
+    int g = 1;
+    while ((long)g * g * 2 < n) ++g;
+    int *cellStart = alocar(sizeof(int) * ((size_t)g * g + 1), "malloc generator");
+    int *cellItems = alocar(sizeof(int) * (size_t)n, "malloc generator");
+    int *cellOf = alocar(sizeof(int) * (size_t)n, "malloc generator");
+    memset(cellStart, 0, sizeof(int) * ((size_t)g * g + 1));
+    for (int i = 0; i < n; ++i) {
+        int cx = (int)(pts[i].x * g), cy = (int)(pts[i].y * g);
+        cellOf[i] = cy * g + cx;
+        cellStart[cellOf[i] + 1]++;
+    }
+    for (int c = 0; c < g * g; ++c) cellStart[c + 1] += cellStart[c];
+    int *cursor = alocar(sizeof(int) * ((size_t)g * g), "malloc generator");
+    memcpy(cursor, cellStart, sizeof(int) * (size_t)g * g);
+    for (int i = 0; i < n; ++i) cellItems[cursor[cellOf[i]]++] = i;
+    free(cursor);
+
+    for (int i = 0; i < n; ++i) {
+        int k = degree;
+        if (jitter > 0) k += (int)rngIntervalo(rng, (uint32_t)(2 * jitter + 1)) - jitter;
+        if (k < 1) k = 1;
+        if (k > GERADOR_GRAU_MAX) k = GERADOR_GRAU_MAX;
+        if (k > n - 1) k = n - 1;
+        int best[GERADOR_GRAU_MAX];
+        double bestD[GERADOR_GRAU_MAX];
+        int found = 0;
+        int cx = cellOf[i] % g, cy = cellOf[i] / g;
+        for (int r = 0; r < g; ++r) {
+            // pontos fora do anel r estão a pelo menos r células de distância
+            if (found == k && r > 0) {
+                double lim = (double)(r - 1) / g;
+                if (bestD[k - 1] <= lim * lim) break;
+            }
+            for (int y = cy - r; y <= cy + r; ++y) {
+                if (y < 0 || y >= g) continue;
+                int step = (y == cy - r || y == cy + r) ? 1 : 2 * r; // só a borda do anel
+                for (int x = cx - r; x <= cx + r; x += step ? step : 1) {
+                    if (x < 0 || x >= g) continue;
+                    for (int s = cellStart[y * g + x]; s < cellStart[y * g + x + 1]; ++s) {
+                        int j = cellItems[s];
+                        if (j == i) continue;
+                        double dx = pts[i].x - pts[j].x, dy = pts[i].y - pts[j].y, d = dx * dx + dy * dy;
+                        if (found == k && d >= bestD[k - 1]) continue;
+                        int p = found < k ? found++ : k - 1; // inserção ordenada
+                        while (p > 0 && bestD[p - 1] > d) {
+                            best[p] = best[p - 1];
+                            bestD[p] = bestD[p - 1];
+                            --p;
+                        }
+                        best[p] = j;
+                        bestD[p] = d;
+                    }
+                    if (r == 0) break;
+                }
+            }
+        }
+        for (int m = 0; m < found; ++m) ligarGerador(e, i, best[m]);
+    }
+    free(cellStart);
+    free(cellItems);
+    free(cellOf);
+}
+
+/* Gera o mapa descrito por 'cfg' no tabuleiro vazio 'b' e o finaliza.
+ * Retorna 0 (com mensagem) se os parâmetros forem inválidos. */
+int gerarMapa(Board *b, const MapGenConfig *cfg) {
+    int n = cfg->nTerritories;
+    if (n < 1 || cfg->nPlayers < 0 || cfg->nRegions < 0 || cfg->nRegions > n || cfg->armies < 1) {
+        fprintf(stderr, "gerarMapa: parâmetros inválidos\n");
+        return 0;
+    }
+    Rng rng;
+    rngSemear(&rng, cfg->seed);
+    GenPoint *pts = alocar(sizeof(GenPoint) * (size_t)n, "malloc generator");
+    GenEdges edges = { NULL, 0, 0 };
+    switch (cfg->kind) {
+    case MAPA_GRADE: gerarGrade(&edges, pts, n, cfg->degree >= 8); break;
+    case MAPA_HEX: gerarHex(&edges, pts, n); break;
+    case MAPA_ALEATORIO: gerarAleatorio(&edges, pts, n, cfg->degree, cfg->degreeJitter, &rng); break;
+    default:
+        fprintf(stderr, "gerarMapa: tipo de mapa desconhecido\n");
+        free(pts);
+        return 0;
+    }
+    if (edges.n) qsort(edges.keys, edges.n, sizeof(uint64_t), compararChaves);
+
+    // donos: permutação aleatória dos ids, repartida igualmente
+    int *perm = alocar(sizeof(int) * (size_t)n, "malloc generator");
+    for (int i = 0; i < n; ++i) perm[i] = i;
+    for (int i = n - 1; i > 0; --i) {
+        int j = (int)rngIntervalo(&rng, (uint32_t)(i + 1));
+        int t = perm[i]; perm[i] = perm[j]; perm[j] = t;
+    }
+    int *owner = alocar(sizeof(int) * (size_t)n, "malloc generator");
+    for (int i = 0; i < n; ++i) owner[perm[i]] = cfg->nPlayers ? 1 + i % cfg->nPlayers : 0;
+    free(perm);
+
+    char name[32];
+    for (int i = 0; i < n; ++i) {
+        snprintf(name, sizeof(name), "T%d", i);
+        criarTerritorio(b, name, owner[i], cfg->armies);
+    }
+    free(owner);
+
+    // regiões: grade rx x ry de blocos do plano; bônus ~ tamanho / 4
+    if (cfg->nRegions > 0) {
+        int rx = 1;
+        while ((long)rx * rx < cfg->nRegions) ++rx;
+        int ry = (cfg->nRegions + rx - 1) / rx;
+        for (int r = 0; r < cfg->nRegions; ++r) {
+            snprintf(name, sizeof(name), "R%d", r);
+            criarRegiao(b, name, 0);
+        }
+        int *size = alocar(sizeof(int) * (size_t)cfg->nRegions, "malloc generator");
+        memset(size, 0, sizeof(int) * (size_t)cfg->nRegions);
+        for (int i = 0; i < n; ++i) {
+            int x = (int)(pts[i].x * rx), y = (int)(pts[i].y * ry);
+            if (x >= rx) x = rx - 1;
+            if (y >= ry) y = ry - 1;
+            int r = y * rx + x;
+            if (r >= cfg->nRegions) r = cfg->nRegions - 1; // última linha incompleta
+            definirRegiao(b, b->territories[i], r);
+            size[r]++;
+        }
+        for (int r = 0; r < cfg->nRegions; ++r) b->regionBonus[r] = 1 + size[r] / 4;
+        free(size);
+    }
+
+    for (size_t k = 0; k < edges.n; ++k) {
+        if (k && edges.keys[k] == edges.keys[k - 1]) continue;
+        int a = (int)(edges.keys[k] >> 32), c = (int)(uint32_t)edges.keys[k];
+        adicionarVizinho(b, b->territories[a], b->territories[c]);
+        adicionarVizinho(b, b->territories[c], b->territories[a]);
+    }
+    free(edges.keys);
+    free(pts);
+    finalizarMapa(b);
+    return 1;
+}
+
+/* ------------------------------------------------------------------------
+ * Benchmarks
+ * ------------------------------------------------------------------------ */
+
+/* Relógio monotônico em nanossegundos */
+static uint64_t agoraNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Compara a consulta de adjacência por varredura linear do CSR com os
+ * índices bitset e hash. O mapa sintético é um anel com "hubs" (1 a cada 64
+ * territórios) ligados a grauHub territórios aleatórios; metade das
+ * consultas parte de um hub e metade dos alvos é vizinho de fato.
  */
-void liberarMemoria(Territory **territories, int nTerritories, Mission **missions, int nMissions) {
-    // Liberar cada território
-    if (territories) {
-        for (int i = 0; i < nTerritories; ++i) {
-            Territory *t = territories[i];
-            if (!t) continue;
-            // liberar string do nome
-            if (t->name) {
-                free(t->name);
-                t->name = NULL;
-            }
-            // liberar array de vizinhos (somente o array, não os territórios apontados,
-            // pois eles são liberados pela lista 'territories' principal)
-            if (t->neighbors) {
-                free(t->neighbors);
-                t->neighbors = NULL;
-            }
-            // finalmente liberar o struct Territory
-            free(t);
-            territories[i] = NULL;
-        }
-        // liberar o array que continha os ponteiros para Territory
-        free(territories);
-        territories = NULL;
-    }
-
-    // Liberar cada missão
-    if (missions) {
-        for (int j = 0; j < nMissions; ++j) {
-            Mission *m = missions[j];
-            if (!m) continue;
-            if (m->description) {
-                free(m->description);
-                m->description = NULL;
+void benchAdjacencia(int n, int grauHub, uint64_t seed) {
+    Rng rng;
+    rngSemear(&rng, seed);
+    Board b;
+    inicializarTabuleiro(&b);
+    for (int i = 0; i < n; ++i) criarTerritorio(&b, "T", 1 + i % 2, 3);
+    for (int i = 0; i < n; ++i) {
+        adicionarVizinho(&b, b.territories[i], b.territories[(i + 1) % n]);
+        adicionarVizinho(&b, b.territories[(i + 1) % n], b.territories[i]);
+    }
+    for (int h = 0; h < n; h += 64) {
+        for (int k = 0; k < grauHub; ++k) {
+            int v = (int)rngIntervalo(&rng, n);
+            adicionarVizinho(&b, b.territories[h], b.territories[v]);
+            adicionarVizinho(&b, b.territories[v], b.territories[h]);
+        }
+    }
+    finalizarMapa(&b);
+
+    enum { NQ = 1 << 20, REPS = 8 };
+    int *qFrom = alocar(sizeof(int) * NQ, "malloc bench");
+    int *qTo = alocar(sizeof(int) * NQ, "malloc bench");
+    for (int q = 0; q < NQ; ++q) {
+        int from = (q & 1) ? (int)rngIntervalo(&rng, (n + 63) / 64) * 64 : (int)rngIntervalo(&rng, n);
+        int deg;
+        const int *viz = vizinhos(&b, from, &deg);
+        qFrom[q] = from;
+        qTo[q] = (q & 2) && deg ? viz[rngIntervalo(&rng, deg)] : (int)rngIntervalo(&rng, n);
+    }
+
+    printf("Adjacência: %d territórios, %d arestas, grau dos hubs ~%d\n",
+           n, b.adjOffsets[n], 2 * grauHub);
+    const char *nomes[] = { "varredura linear", "bitset", "hash" };
+    for (int modo = 0; modo < 3; ++modo) {
+        if (modo == 1 && (size_t)n * ((n + 63) / 64) * 8 > (64u << 20)) {
+            printf("  %-17s (ignorado: bitset > 64 MB)\n", nomes[modo]);
+            continue;
+        }
+        if (modo > 0) construirIndiceAdjacencia(&b, modo == 1 ? ADJ_INDICE_BITSET : ADJ_INDICE_HASH);
+        long hits = 0;
+        uint64_t t0 = agoraNs();
+        for (int r = 0; r < REPS; ++r) {
+            for (int q = 0; q < NQ; ++q)
+                hits += modo == 0 ? saoVizinhosLinear(&b, qFrom[q], qTo[q])
+                                  : saoVizinhos(&b, qFrom[q], qTo[q]);
+        }
+        double ns = (double)(agoraNs() - t0) / ((double)NQ * REPS);
+        printf("  %-17s %7.2f ns/consulta (%ld vizinhos)\n", nomes[modo], ns, hits);
+    }
+
+    free(qFrom);
+    free(qTo);
+    liberarMemoria(&b);
+    arenaDestroy(&b.arena);
+}
+
+/* Mapa sintético dos benchmarks: grade de largura ~sqrt(n) com vizinhos
+ * nas 4 direções (planar, como um mapa real), dois jogadores em faixas de
+ * 8 territórios, 3 exércitos em cada. Nomes distintos, como num mapa real. */
+static void montarMapaBench(Board *b, int n) {
+    char name[32];
+    int w = 1;
+    while ((long)w * w < n) ++w;
+    for (int i = 0; i < n; ++i) {
+        snprintf(name, sizeof(name), "T%d", i);
+        criarTerritorio(b, name, 1 + (i / 8) % 2, 3);
+    }
+    for (int i = 0; i < n; ++i) {
+        int right = i % w + 1 < w && i + 1 < n ? i + 1 : -1;
+        int down = i + w < n ? i + w : -1;
+        if (right >= 0) {
+            adicionarVizinho(b, b->territories[i], b->territories[right]);
+            adicionarVizinho(b, b->territories[right], b->territories[i]);
+        }
+        if (down >= 0) {
+            adicionarVizinho(b, b->territories[i], b->territories[down]);
+            adicionarVizinho(b, b->territories[down], b->territories[i]);
+        }
+    }
+    finalizarMapa(b);
+}
+
+/* Tempo e alocações de uma fase */
+typedef struct BenchPhase {
+    uint64_t t0;
+    long allocs0;
+} BenchPhase;
+
+static inline void iniciarFase(BenchPhase *f) {
+    f->allocs0 = atomic_load_explicit(&alocacoes, memory_order_relaxed);
+    f->t0 = agoraNs();
+}
+
+/* ns por operação desde iniciarFase; 'allocs' recebe as alocações */
+static inline double fimFase(const BenchPhase *f, long ops, long *allocs) {
+    double ns = (double)(agoraNs() - f->t0) / (double)(ops ? ops : 1);
+    *allocs = atomic_load_explicit(&alocacoes, memory_order_relaxed) - f->allocs0;
+    return ns;
+}
+
+/* Suite de benchmarks do ciclo de vida de um mapa, de 10 até maxN
+ * territórios (potências de 10): montagem (criarTerritorio +
+ * adicionarVizinho + finalizarMapa), validarAtaque, resolverAtaque, a fase
+ * de reforço (calcularReforcos + aplicarReforcos de todos os jogadores) e
+ * liberarMemoria. Imprime ns/op e alocações de cada fase; compilar com -O2
+ * (tarefa "gcc otimizado" do VS Code) para números representativos. */
+void benchSuite(int maxN, uint64_t seed) {
+    enum { NQ = 1 << 20 };
+    Rng rng;
+    rngSemear(&rng, seed);
+    int *qFrom = alocar(sizeof(int) * NQ, "malloc bench");
+    int *qTo = alocar(sizeof(int) * NQ, "malloc bench");
+
+    printf("%9s | %-21s | %-19s | %-19s | %-19s | %-19s\n", "território", "montar (ns/terr, aloc)",
+           "validar (ns, aloc)", "resolver (ns, aloc)", "reforço (ns, aloc)", "liberar (ns/terr)");
+    for (int n = 10; n <= maxN; n *= 10) {
+        Board b;
+        BenchPhase f;
+        long aBuild, aValid, aResolve, aReinforce, aFree;
+
+        iniciarFase(&f);
+        inicializarTabuleiro(&b);
+        montarMapaBench(&b, n);
+        double nsBuild = fimFase(&f, n, &aBuild);
+
+        // metade das consultas é um ataque válido, metade um par qualquer
+        int nEdges = b.adjOffsets[n];
+        for (int q = 0; q < NQ; ++q) {
+            int e = (int)rngIntervalo(&rng, (uint32_t)nEdges);
+            int from = (int)rngIntervalo(&rng, (uint32_t)n);
+            if (q & 1) {
+                qFrom[q] = from;
+                qTo[q] = (int)rngIntervalo(&rng, (uint32_t)n);
+            } else {
+                // origem da aresta e: maior i com adjOffsets[i] <= e
+                int lo = 0, hi = n - 1;
+                while (lo < hi) {
+                    int mid = (lo + hi + 1) / 2;
+                    if (b.adjOffsets[mid] <= e) lo = mid; else hi = mid - 1;
+                }
+                qFrom[q] = lo;
+                qTo[q] = b.adjList[e];
             }
-            free(m);
-            missions[j] = NULL;
         }
-        // liberar o array que continha os ponteiros para Mission
-        free(missions);
-        missions = NULL;
+
+        long valid = 0;
+        iniciarFase(&f);
+        for (int q = 0; q < NQ; ++q)
+            valid += validarAtaque(&b, b.territories[qFrom[q]], b.territories[qTo[q]], b.owner[qFrom[q]]);
+        double nsValid = fimFase(&f, NQ, &aValid);
+
+        // só arestas reais; atacantes sem exércitos são recompletados
+        long conquered = 0, resolves = 0;
+        iniciarFase(&f);
+        for (int q = 0; q < NQ; q += 2) {
+            int from = qFrom[q], to = qTo[q];
+            if (b.armies[from] < 2) definirExercitos(&b, from, 3);
+            conquered += resolverAtaque(&b, &rng, b.territories[from], b.territories[to], NULL);
+            resolves++;
+        }
+        double nsResolve = fimFase(&f, resolves, &aResolve);
+
+        // uma rodada de reforço: renda de todos calculada junto, depois aplicada
+        int *scratch = alocar(sizeof(int) * n, "malloc bench");
+        long placed = 0;
+        iniciarFase(&f);
+        ReinforcementPlan plan;
+        calcularReforcos(&b, &plan);
+        for (int p = 1; p <= plan.nPlayers; ++p) {
+            aplicarReforcos(&b, &rng, p, &plan, scratch);
+            placed += plan.income[p];
+        }
+        liberarPlanoReforco(&plan);
+        double nsReinforce = fimFase(&f, placed, &aReinforce);
+        free(scratch);
+
+        iniciarFase(&f);
+        liberarMemoria(&b);
+        arenaDestroy(&b.arena);
+        double nsFree = fimFase(&f, n, &aFree);
+
+        printf("%9d | %9.1f %11ld | %7.2f %11ld | %7.2f %11ld | %7.2f %11ld | %9.2f\n",
+               n, nsBuild, aBuild, nsValid, aValid, nsResolve, aResolve, nsReinforce, aReinforce, nsFree);
+        printf("%9s   (%ld ataques válidos, %ld conquistas, %ld exércitos de reforço)\n", "", valid, conquered, placed);
     }
+    free(qFrom);
+    free(qTo);
+}
+
+/* Segunda tabela de --bench, nos mesmos mapas: alcancavel, buscaLargura
+ * (BFS completa, ns por território), inimigoMaisProximo, copiarEstadoCompacto
+ * (ns por território) e buscarAtaque com aprofundamento iterativo até
+ * BENCH_BUSCA_PROF sobre uma tabela de transposição. */
+#define BENCH_BUSCA_PROF 4
+
+void benchConsultas(int maxN, uint64_t seed) {
+    enum { NQ = 1 << 16 };
+    Rng rng;
+    rngSemear(&rng, seed);
+    int *qFrom = alocar(sizeof(int) * NQ, "malloc bench");
+    int *qTo = alocar(sizeof(int) * NQ, "malloc bench");
+
+    printf("\n%9s | %-17s | %-14s | %-16s | %-14s | %-30s\n", "território", "alcançável (ns)", "BFS (ns/terr)",
+           "inimigo (ns)", "cópia (ns/terr)", "busca (nós, na tabela, µs)");
+    for (int n = 10; n <= maxN; n *= 10) {
+        Board b;
+        inicializarTabuleiro(&b);
+        montarMapaBench(&b, n);
+        for (int q = 0; q < NQ; ++q) {
+            qFrom[q] = (int)rngIntervalo(&rng, (uint32_t)n);
+            qTo[q] = (int)rngIntervalo(&rng, (uint32_t)n);
+        }
+
+        long reachable = 0;
+        uint64_t t0 = agoraNs();
+        for (int q = 0; q < NQ; ++q) reachable += alcancavel(&b, qFrom[q], qTo[q]);
+        double nsReach = (double)(agoraNs() - t0) / NQ;
+
+        // BFS completas até somar ~2^22 territórios visitados
+        GraphQuery gq;
+        criarConsultaGrafo(&gq, &b);
+        int nBfs = n < (1 << 22) ? (1 << 22) / n : 1;
+        long visited = 0;
+        t0 = agoraNs();
+        for (int q = 0; q < nBfs; ++q) visited += buscaLargura(&gq, &qFrom[q % NQ], 1, -1, -1);
+        double nsBfs = (double)(agoraNs() - t0) / (double)visited;
+
+        long distSum = 0;
+        t0 = agoraNs();
+        for (int q = 0; q < NQ; ++q) {
+            int d = 0;
+            if (inimigoMaisProximo(&gq, qFrom[q], -1, &d) >= 0) distSum += d;
+        }
+        double nsEnemy = (double)(agoraNs() - t0) / NQ;
+        liberarConsultaGrafo(&gq);
 
-    // Observação: não há retorno. Após chamar liberarMemoria, todos os dados
-    // alocados dinamicamente serão liberados.
+        PackedState src, dst;
+        criarEstadoCompacto(&src, &b);
+        criarEstadoCompacto(&dst, &b);
+        empacotarEstado(&b, &src);
+        int nCopies = n < (1 << 24) ? (1 << 24) / n : 1;
+        t0 = agoraNs();
+        for (int q = 0; q < nCopies; ++q) copiarEstadoCompacto(&dst, &src);
+        double nsCopy = (double)(agoraNs() - t0) / ((double)nCopies * n);
+
+        TranspositionTable tt;
+        criarTabelaTransposicao(&tt, 16);
+        AttackSearch search;
+        iniciarBuscaAtaques(&search, &b, &rng, &tt, 1);
+        Attack best = { -1, -1 };
+        int gain = 0;
+        inicializarTabelaBatalha(); // fora da medição
+        t0 = agoraNs();
+        for (int depth = 1; depth <= BENCH_BUSCA_PROF; ++depth) gain = buscarAtaque(&search, depth, &best);
+        double usSearch = (double)(agoraNs() - t0) / 1000.0;
+        liberarTabelaTransposicao(&tt);
+
+        // a busca desfaz tudo o que fez
+        empacotarEstado(&b, &dst);
+        int restored = estadoCompactoIgual(&src, &dst);
+        liberarEstadoCompacto(&src);
+        liberarEstadoCompacto(&dst);
+
+        printf("%9d | %17.2f | %14.2f | %16.2f | %15.3f | %9ld %9ld %10.1f\n", n, nsReach, nsBfs, nsEnemy, nsCopy,
+               search.nodes, search.ttHits, usSearch);
+        printf("%9s   (%ld alcançáveis, distância média %.2f, melhor ataque %d -> %d com ganho %d%s)\n", "",
+               reachable, (double)distSum / NQ, best.from, best.to, gain,
+               restored ? "" : ", TABULEIRO NÃO RESTAURADO");
+        liberarMemoria(&b);
+        arenaDestroy(&b.arena);
+    }
+    free(qFrom);
+    free(qTo);
 }
 
-/* Exemplo de uso */
-int main(void) {
-    srand((unsigned)time(NULL)); // gerar números aleatórios (boa prática)
+/* Benchmark do kernel de batalhas: n batalhas de tamanhos aleatórios
+ * (2..40 contra 1..40) no kernel e no laço escalar de rodadas, e a
+ * estimativa de conquista comparada com a tabela exata */
+void benchDados(int n, uint64_t seed) {
+    Rng rng;
+    rngSemear(&rng, seed);
+    int32_t *a0 = alocar(sizeof(int32_t) * n, "malloc bench");
+    int32_t *d0 = alocar(sizeof(int32_t) * n, "malloc bench");
+    int32_t *a = alocar(sizeof(int32_t) * n, "malloc bench");
+    int32_t *d = alocar(sizeof(int32_t) * n, "malloc bench");
+    for (int i = 0; i < n; ++i) {
+        a0[i] = 2 + (int32_t)rngIntervalo(&rng, 39);
+        d0[i] = 1 + (int32_t)rngIntervalo(&rng, 40);
+    }
+
+    memcpy(a, a0, sizeof(int32_t) * n);
+    memcpy(d, d0, sizeof(int32_t) * n);
+    DiceKernel k;
+    iniciarKernelDados(&k, seed);
+    uint64_t t0 = agoraNs();
+    long kernelWins = resolverBatalhasEmLote(&k, a, d, n);
+    double nsKernel = (double)(agoraNs() - t0) / n;
+
+    long scalarWins = 0;
+    t0 = agoraNs();
+    for (int i = 0; i < n; ++i) {
+        int x = a0[i], y = d0[i];
+        while (x >= 2 && y >= 1) {
+            if (rngIntervalo(&rng, 36) < BATALHA_P_ATACANTE) --y; else --x;
+        }
+        scalarWins += y == 0;
+    }
+    double nsScalar = (double)(agoraNs() - t0) / n;
+
+    printf("Batalhas: %d (2..40 contra 1..40), %d faixas\n", n, DADOS_LANES);
+    printf("  %-8s %8.1f ns/batalha (%ld conquistas)\n", "kernel", nsKernel, kernelWins);
+    printf("  %-8s %8.1f ns/batalha (%ld conquistas)\n", "escalar", nsScalar, scalarWins);
+    static const int casos[][2] = { { 5, 5 }, { 10, 8 }, { 30, 25 } };
+    for (size_t c = 0; c < sizeof(casos) / sizeof(casos[0]); ++c) {
+        int A = casos[c][0], D = casos[c][1];
+        printf("  %2d x %-2d  estimado %.4f | exato %.4f\n", A, D,
+               estimarConquista(&k, A, D, 1000000), probabilidadeConquista(A, D));
+    }
+    free(a0);
+    free(d0);
+    free(a);
+    free(d);
+}
 
+/* Mapa de exemplo: Amazônia (jogador 1), Sertão (jogador 2) e Litoral (neutro) */
+void montarMapaExemplo(Board *b) {
     // --- Criar alguns territórios dinamicamente ---
-    int nTerritories = 3;
-    Territory **territories = malloc(sizeof(Territory *) * nTerritories);
-    if (!territories) { perror("malloc territories"); exit(EXIT_FAILURE); }
+    Territory *amazonia = criarTerritorio(b, "Amazônia", 1, 5);
+    Territory *sertao = criarTerritorio(b, "Sertão", 2, 3);
+    Territory *litoral = criarTerritorio(b, "Litoral", 0, 2);
 
-    territories[0] = criarTerritorio("Amazônia", 1, 5);
-    territories[1] = criarTerritorio("Sertão", 2, 3);
-    territories[2] = criarTerritorio("Litoral", 0, 2);
+    // regiões
+    int norte = criarRegiao(b, "Norte", 2);
+    int nordeste = criarRegiao(b, "Nordeste", 3);
+    definirRegiao(b, amazonia, norte);
+    definirRegiao(b, sertao, nordeste);
+    definirRegiao(b, litoral, nordeste);
 
     // criar vizinhanças (grafo simples)
-    adicionarVizinho(territories[0], territories[1]); // Amazônia <-> Sertão
-    adicionarVizinho(territories[1], territories[0]);
-    adicionarVizinho(territories[1], territories[2]); // Sertão <-> Litoral
-    adicionarVizinho(territories[2], territories[1]);
+    adicionarVizinho(b, amazonia, sertao); // Amazônia <-> Sertão
+    adicionarVizinho(b, sertao, amazonia);
+    adicionarVizinho(b, sertao, litoral);  // Sertão <-> Litoral
+    adicionarVizinho(b, litoral, sertao);
+    finalizarMapa(b);
+}
+
+/* Tabuleiro modelo dos comandos: arquivo binário, mapa gerado (se
+ * gen->nTerritories > 0) ou o mapa de exemplo */
+static int carregarModelo(Board *model, const char *mapPath, const MapGenConfig *gen) {
+    if (mapPath) return carregarMapaBinario(model, mapPath);
+    inicializarTabuleiro(model);
+    if (gen->nTerritories > 0) {
+        if (gerarMapa(model, gen)) return 1;
+        liberarMemoria(model);
+        arenaDestroy(&model->arena);
+        return 0;
+    }
+    montarMapaExemplo(model);
+    return 1;
+}
+
+/* Autoteste do replay: grava sobre um mapa mínimo a conquista de territórios
+ * com 0 exércitos (por resolverBatalha e por resolverAtaque), volta ao
+ * estado inicial e confere que a reprodução chega ao mesmo estado. Usa
+ * 'path' como arquivo temporário. Retorna 1 se passou. */
+static int testarReplayConquista(const char *path) {
+    Board b;
+    inicializarTabuleiro(&b);
+    Territory *a = criarTerritorio(&b, "Origem", 1, 10);
+    Territory *vazio1 = criarTerritorio(&b, "Vazio 1", 2, 0);
+    Territory *vazio2 = criarTerritorio(&b, "Vazio 2", 2, 0);
+    adicionarVizinho(&b, a, vazio1);
+    adicionarVizinho(&b, vazio1, a);
+    adicionarVizinho(&b, a, vazio2);
+    adicionarVizinho(&b, vazio2, a);
+    finalizarMapa(&b);
+    PackedState initial;
+    criarEstadoCompacto(&initial, &b);
+    empacotarEstado(&b, &initial);
+
+    ReplayMapInfo info = { REPLAY_MAPA_EXEMPLO, 0, 0, 0, 0, 0, 0, 0, 0 };
+    ReplayLog *log = alocar(sizeof(ReplayLog), "malloc replay");
+    int ok = abrirReplay(log, path, &b, 1, &info);
+    int conquered1 = 0, conquered2 = 0;
+    if (ok) {
+        b.replay = log;
+        Rng rng;
+        rngSemear(&rng, 1);
+        conquered1 = resolverBatalha(&b, &rng, a, vazio1, NULL);
+        while (!conquered2 && b.armies[a->id] >= 2) conquered2 = resolverAtaque(&b, &rng, a, vazio2, NULL);
+        b.replay = NULL;
+        ok = fecharReplay(log, &b);
+    }
+    uint64_t finalHash = b.hash;
+    int finalArmies[3] = { b.armies[a->id], b.armies[vazio1->id], b.armies[vazio2->id] };
+    free(log);
+
+    long events = 0;
+    if (ok) {
+        aplicarEstadoCompacto(&b, &initial);
+        ok = reproduzirReplay(&b, path, &events);
+    }
+    ok = ok && conquered1 && conquered2 && b.hash == finalHash && b.owner[vazio1->id] == 1 &&
+         b.owner[vazio2->id] == 1 && b.armies[a->id] == finalArmies[0] && b.armies[vazio1->id] == finalArmies[1] &&
+         b.armies[vazio2->id] == finalArmies[2];
+    printf("replay de conquista de território vazio: %s (%ld eventos; exércitos finais %d, %d, %d)\n",
+           ok ? "ok" : "FALHOU", events, b.armies[a->id], b.armies[vazio1->id], b.armies[vazio2->id]);
+    liberarEstadoCompacto(&initial);
+    liberarMemoria(&b);
+    arenaDestroy(&b.arena);
+    return ok;
+}
+
+/* Exemplo de uso
+ *
+ * ./war [--semente s]                            partida de exemplo
+ * ./war [--semente s] [--mapa arq | --gerar ...] --simular [n] [threads]
+ *                                                n partidas aleatórias (mapa de exemplo, arquivo ou gerado)
+ * ./war [--gerar ...] --salvar-mapa arq          grava o mapa (de exemplo ou gerado) no formato binário
+ * ./war [--semente s] --gerar tipo n p r g ...    usa um mapa sintético (tipo grade, hex ou aleatorio;
+ *                                                n territórios, p jogadores, r regiões, grau g)
+ * ./war [--semente s] --bench-adjacencia [n] [g]  benchmark de adjacência (n territórios, hubs de grau ~2g)
+ * ./war [--semente s] --bench [n]               suite de benchmarks em mapas de 10 a n territórios
+ * ./war [--semente s] --bench-dados [n]         kernel vetorial de batalhas contra o laço escalar
+ * ./war [--semente s] [--mapa arq | --gerar ...] --gravar arq
+ *                                                joga uma partida aleatória gravando o replay em arq
+ * ./war [--mapa arq] --reproduzir arq             reaplica o replay; mapas gerados são refeitos com os
+ *                                                parâmetros e a semente guardados no replay
+ * ./war [--semente s] [--mapa arq | --gerar ...] --servidor [n] [threads]
+ *                                                hospeda n partidas simultâneas num pool de threads
+ * ./war --testar-replay arq                      autoteste de gravação/reprodução (arq é temporário)
+ *
+ * Sem --semente, a semente vem do relógio e é impressa para reproduzir a partida.
+ */
+int main(int argc, char **argv) {
+    uint64_t seed = (uint64_t)time(NULL);
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "--semente") == 0) {
+        seed = strtoull(argv[arg + 1], NULL, 10);
+        arg += 2;
+    }
+    const char *mapPath = NULL;
+    if (arg + 1 < argc && strcmp(argv[arg], "--mapa") == 0) {
+        mapPath = argv[arg + 1];
+        arg += 2;
+    }
+    MapGenConfig gen = { MAPA_GRADE, 0, 4, 8, 6, 2, 3, seed };
+    if (arg < argc && strcmp(argv[arg], "--gerar") == 0 && (mapPath || arg + 5 >= argc)) {
+        fprintf(stderr, mapPath ? "--gerar não pode ser usado junto com --mapa\n"
+                                : "--gerar precisa de tipo n p r g\n");
+        return EXIT_FAILURE;
+    }
+    if (arg + 5 < argc && strcmp(argv[arg], "--gerar") == 0) {
+        const char *kind = argv[arg + 1];
+        if (strcmp(kind, "grade") == 0) gen.kind = MAPA_GRADE;
+        else if (strcmp(kind, "hex") == 0) gen.kind = MAPA_HEX;
+        else if (strcmp(kind, "aleatorio") == 0) gen.kind = MAPA_ALEATORIO;
+        else { fprintf(stderr, "tipo de mapa desconhecido: %s\n", kind); return EXIT_FAILURE; }
+        gen.nTerritories = atoi(argv[arg + 2]);
+        gen.nPlayers = atoi(argv[arg + 3]);
+        gen.nRegions = atoi(argv[arg + 4]);
+        gen.degree = atoi(argv[arg + 5]);
+        arg += 6;
+        if (arg < argc && strcmp(argv[arg], "--mapa") == 0) {
+            fprintf(stderr, "--gerar não pode ser usado junto com --mapa\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (arg + 1 < argc && strcmp(argv[arg], "--salvar-mapa") == 0) {
+        Board model;
+        if (!carregarModelo(&model, mapPath, &gen)) return EXIT_FAILURE;
+        int ok = salvarMapaBinario(&model, argv[arg + 1]);
+        liberarMemoria(&model);
+        arenaDestroy(&model.arena);
+        return ok ? 0 : EXIT_FAILURE;
+    }
+
+    if (arg < argc && strcmp(argv[arg], "--bench-adjacencia") == 0) {
+        int n = arg + 1 < argc ? atoi(argv[arg + 1]) : 100000;
+        int g = arg + 2 < argc ? atoi(argv[arg + 2]) : 256;
+        if (n < 2 || g < 0) { fprintf(stderr, "parâmetros inválidos\n"); return EXIT_FAILURE; }
+        benchAdjacencia(n, g, seed);
+        return 0;
+    }
+
+    if (arg < argc && strcmp(argv[arg], "--bench") == 0) {
+        int n = arg + 1 < argc ? atoi(argv[arg + 1]) : 1000000;
+        if (n < 10) { fprintf(stderr, "parâmetros inválidos\n"); return EXIT_FAILURE; }
+        benchSuite(n, seed);
+        benchConsultas(n, seed);
+        return 0;
+    }
+
+    if (arg < argc && strcmp(argv[arg], "--bench-dados") == 0) {
+        int n = arg + 1 < argc ? atoi(argv[arg + 1]) : 1000000;
+        if (n < 1) { fprintf(stderr, "parâmetros inválidos\n"); return EXIT_FAILURE; }
+        benchDados(n, seed);
+        return 0;
+    }
+
+    if (arg + 1 < argc && strcmp(argv[arg], "--gravar") == 0) {
+        SimConfig cfg = { 1, 1, 200, 3, 1, seed };
+        Board model;
+        if (!carregarModelo(&model, mapPath, &gen)) return EXIT_FAILURE;
+        ReplayMapInfo info = { mapPath ? REPLAY_MAPA_ARQUIVO : gen.nTerritories > 0 ? REPLAY_MAPA_GERADO : REPLAY_MAPA_EXEMPLO,
+                               (int32_t)gen.kind, gen.nTerritories, gen.nPlayers, gen.nRegions, gen.degree,
+                               gen.degreeJitter, gen.armies, gen.seed };
+        ReplayLog *log = alocar(sizeof(ReplayLog), "malloc replay");
+        if (!abrirReplay(log, argv[arg + 1], &model, seed, &info)) return EXIT_FAILURE;
+        model.replay = log;
+        Rng rng;
+        rngSemear(&rng, seed);
+        Attack *moves = alocar(sizeof(Attack) * (model.adjOffsets[model.nTerritories] + 1), "malloc moves");
+        int *scratch = alocar(sizeof(int) * (model.nTerritories + 1), "malloc scratch");
+        int turns, winner = simularPartida(&model, &rng, &cfg, moves, scratch, &turns);
+        int ok = fecharReplay(log, &model);
+        printf("Semente: %llu | %d turnos, vencedor %d | %llu eventos gravados (hash final %016llx)\n",
+               (unsigned long long)seed, turns, winner, (unsigned long long)log->header.events,
+               (unsigned long long)model.hash);
+        free(moves);
+        free(scratch);
+        free(log);
+        liberarMemoria(&model);
+        arenaDestroy(&model.arena);
+        return ok ? 0 : EXIT_FAILURE;
+    }
+
+    if (arg + 1 < argc && strcmp(argv[arg], "--testar-replay") == 0) {
+        int ok = testarReplayConquista(argv[arg + 1]);
+        remove(argv[arg + 1]);
+        return ok ? 0 : EXIT_FAILURE;
+    }
+
+    if (arg + 1 < argc && strcmp(argv[arg], "--reproduzir") == 0) {
+        ReplayMapInfo info;
+        if (!lerMapaReplay(argv[arg + 1], &info)) return EXIT_FAILURE;
+        if (!mapPath && info.source == REPLAY_MAPA_ARQUIVO) {
+            fprintf(stderr, "%s: gravado sobre um arquivo de mapa; informe-o com --mapa\n", argv[arg + 1]);
+            return EXIT_FAILURE;
+        }
+        // o mapa vem do replay, não de --gerar/--semente desta execução
+        MapGenConfig replayGen = { (MapKind)info.kind, info.source == REPLAY_MAPA_GERADO ? info.nTerritories : 0,
+                                   info.nPlayers, info.nRegions, info.degree, info.degreeJitter, info.armies,
+                                   info.seed };
+        Board model;
+        if (!carregarModelo(&model, mapPath, &replayGen)) return EXIT_FAILURE;
+        long events;
+        uint64_t t0 = agoraNs();
+        int ok = reproduzirReplay(&model, argv[arg + 1], &events);
+        double secs = (double)(agoraNs() - t0) * 1e-9;
+        if (ok) {
+            printf("%ld eventos reproduzidos em %.3f s (%.0f eventos/s, hash final %016llx)\n",
+                   events, secs, events / (secs > 0 ? secs : 1e-9), (unsigned long long)model.hash);
+        }
+        liberarMemoria(&model);
+        arenaDestroy(&model.arena);
+        return ok ? 0 : EXIT_FAILURE;
+    }
+
+    if (arg < argc && strcmp(argv[arg], "--servidor") == 0) {
+        SimConfig cfg = { 10000, 0, 200, 3, 1, seed };
+        if (arg + 1 < argc) cfg.nGames = atol(argv[arg + 1]);
+        if (arg + 2 < argc) cfg.nThreads = atoi(argv[arg + 2]);
+        if (cfg.nGames < 1 || cfg.nThreads < 0) { fprintf(stderr, "parâmetros inválidos\n"); return EXIT_FAILURE; }
+        Board model;
+        if (!carregarModelo(&model, mapPath, &gen)) return EXIT_FAILURE;
+        arenaUsarPool(&model.arena); // partidas encerradas devolvem os blocos para as próximas
+        MatchServer srv;
+        uint64_t t0 = agoraNs();
+        iniciarServidor(&srv, &model, &cfg);
+        for (long g = 0; g < cfg.nGames; ++g)
+            submeterPartida(&srv, seed ^ (0x9E3779B97F4A7C15ull * (uint64_t)(g + 1)));
+        SimStats stats;
+        long peak, byMission;
+        encerrarServidor(&srv, &stats, &peak, &byMission);
+        double secs = (double)(agoraNs() - t0) * 1e-9;
+        printf("Semente: %llu | %ld partidas em %d threads, até %ld simultâneas, em %.3f s (%.0f partidas/s)\n",
+               (unsigned long long)seed, stats.games, srv.nShards, peak, secs, stats.games / secs);
+        printf("  %.1f turnos/partida, %ld vencidas por missão\n", (double)stats.turns / stats.games, byMission);
+        for (int p = 1; p <= stats.nPlayers; ++p)
+            printf("  jogador %d: %6.2f%% de vitórias\n", p, 100.0 * stats.wins[p] / stats.games);
+        printf("  empates:   %6.2f%%\n", 100.0 * stats.draws / stats.games);
+        liberarEstatisticas(&stats);
+        liberarMemoria(&model);
+        arenaDestroy(&model.arena);
+        esvaziarPoolArena();
+        return 0;
+    }
+
+    if (arg < argc && strcmp(argv[arg], "--simular") == 0) {
+        SimConfig cfg = { 100000, 0, 200, 3, 1, seed };
+        if (arg + 1 < argc) cfg.nGames = atol(argv[arg + 1]);
+        if (arg + 2 < argc) cfg.nThreads = atoi(argv[arg + 2]);
+        if (cfg.nGames < 1 || cfg.nThreads < 0) { fprintf(stderr, "parâmetros inválidos\n"); return EXIT_FAILURE; }
+        Board model;
+        if (!carregarModelo(&model, mapPath, &gen)) return EXIT_FAILURE;
+        printf("Mapa: %d territórios, %d arestas, %d jogadores, %d regiões\n", model.nTerritories,
+               model.adjOffsets[model.nTerritories], model.nPlayers, model.nRegions);
+        SimStats stats;
+        uint64_t t0 = agoraNs();
+        simularPartidas(&model, &cfg, &stats);
+        double secs = (double)(agoraNs() - t0) * 1e-9;
+        printf("Semente: %llu | %ld partidas em %.3f s (%.0f partidas/s, %.1f turnos/partida)\n",
+               (unsigned long long)seed, stats.games, secs, stats.games / secs,
+               (double)stats.turns / stats.games);
+        for (int p = 1; p <= stats.nPlayers; ++p)
+            printf("  jogador %d: %6.2f%% de vitórias\n", p, 100.0 * stats.wins[p] / stats.games);
+        printf("  empates:   %6.2f%%\n", 100.0 * stats.draws / stats.games);
+        liberarEstatisticas(&stats);
+        liberarMemoria(&model);
+        arenaDestroy(&model.arena);
+        return 0;
+    }
+
+    // gerador de números aleatórios da partida (estado explícito, reproduzível)
+    Rng rng;
+    rngSemear(&rng, seed);
+
+    // saída da partida: enfileirada e gravada por uma thread à parte
+    Logger log;
+    iniciarLogger(&log, STDOUT_FILENO, 12, LOG_ESPERAR);
+    logTexto(&log, "Semente: %llu\n", (unsigned long long)seed);
+
+    // tabuleiro que guarda toda a memória desta partida
+    Board board;
+    inicializarTabuleiro(&board);
+
+    montarMapaExemplo(&board);
+    board.sink = registrarCombateLog; // partida interativa: mostrar os combates
+    board.sinkCtx = &log;
 
     // --- Criar missões ---
     int nMissions = 2;
-    Mission **missions = malloc(sizeof(Mission *) * nMissions);
-    if (!missions) { perror("malloc missions"); liberarMemoria(territories, nTerritories, NULL, 0); exit(EXIT_FAILURE); }
+    Mission **missions = arenaAlloc(&board.arena, sizeof(Mission *) * nMissions);
 
-    missions[0] = criarMissao("Conquistar 3 territórios da região Norte", 0);
-    missions[1] = criarMissao("Eliminar jogador 2", 2);
+    // Norte só tem a Amazônia no mapa de exemplo
+    missions[0] = criarMissao(&board, "Conquistar 1 território da região Norte",
+                              MISSAO_CONQUISTAR_REGIAO, 0, 0 /* Norte */, 1);
+    missions[1] = criarMissao(&board, "Eliminar jogador 2", MISSAO_ELIMINAR, 2, -1, 0);
 
     // --- Exemplo de validação e ataque ---
-    Territory *from = territories[0]; // Amazônia (owner=1)
-    Territory *to = territories[1];   // Sertão (owner=2)
+    Territory *from = board.territories[0]; // Amazônia (owner=1)
+    Territory *to = board.territories[1];   // Sertão (owner=2)
     int playerId = 1;
 
-    printf("Tentativa de ataque de %s para %s pelo jogador %d\n", from->name, to->name, playerId);
-    if (validarAtaque(from, to, playerId)) {
-        printf("Ataque válido. Resolvendo combate...\n");
-        resolverAtaque(from, to);
+    logTexto(&log, "Tentativa de ataque de %s para %s pelo jogador %d\n", nomeTerritorio(from),
+             nomeTerritorio(to), playerId);
+    if (validarAtaque(&board, from, to, playerId)) {
+        logTexto(&log, "Ataque válido. Resolvendo combate...\n");
+        resolverAtaque(&board, &rng, from, to, NULL);
     } else {
-        printf("Ataque inválido: só é permitido atacar territórios inimigos vizinhos com exércitos suficientes.\n");
+        logTexto(&log, "Ataque inválido: só é permitido atacar territórios inimigos vizinhos com exércitos suficientes.\n");
+    }
+
+    // --- Verificar as missões do jogador (O(1) cada) ---
+    for (int i = 0; i < nMissions; ++i) {
+        logTexto(&log, "Missão \"%s\": %s\n", descricaoMissao(missions[i]),
+                 missaoCumprida(&board, missions[i], playerId) ? "cumprida" : "pendente");
     }
 
     // --- Final: liberar toda a memória antes de sair ---
-    liberarMemoria(territories, nTerritories, missions, nMissions);
+    liberarMemoria(&board);
+    arenaDestroy(&board.arena);
 
-    printf("Memória liberada com sucesso. Encerrando.\n");
+    logTexto(&log, "Memória liberada com sucesso. Encerrando.\n");
+    encerrarLogger(&log);
     return 0;
-}
\ No newline at end of file
+}